@@ -0,0 +1,260 @@
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/syscall.h>
+
+/* 吞噬窗口用的进程树。能订阅内核 proc connector 时 (需要 CAP_NET_ADMIN)
+ * 根据 fork/exit 事件增量维护 pid -> ppid,不用再读 /proc;
+ * 没有权限时退回到 getparentprocess 的缓存,并给终端窗口注册 pidfd,
+ * 终端进程退出后立刻把它剔除 */
+
+/* 进程退出后子进程会被过继,记录里的 ppid 不会跟着变,这个 pid 还可能被
+ * 复用。所以每条记录带一个插入时的编号,子进程记下父进程当时的编号,
+ * 查的时候父进程的记录还在且编号一致才信 */
+typedef struct {
+	pid_t pid, ppid;
+	unsigned long gen, parent_gen; /* parent_gen 为 0 表示父进程不在树里 */
+} ProcLink;
+
+static int proc_events_fd = -1;
+static struct wl_event_source *proc_events_source;
+static ProcLink *proc_tree; /* 开放寻址,pid 为 0 表示空位 */
+static unsigned int proc_tree_size, proc_tree_count;
+static unsigned long proc_tree_gen;
+
+static unsigned int proc_tree_slot(pid_t pid) {
+	unsigned int i = (unsigned int)pid * 2654435761u & (proc_tree_size - 1);
+
+	while (proc_tree[i].pid && proc_tree[i].pid != pid)
+		i = (i + 1) & (proc_tree_size - 1);
+	return i;
+}
+
+bool proc_tree_parent(pid_t pid, pid_t *ppid) {
+	unsigned int i, j;
+
+	if (!proc_tree_count)
+		return false;
+	i = proc_tree_slot(pid);
+	if (!proc_tree[i].pid)
+		return false;
+	// 父进程已经退出或者 pid 被复用了,交给 /proc 读真正的父进程
+	j = proc_tree_slot(proc_tree[i].ppid);
+	if (!proc_tree[i].parent_gen || !proc_tree[j].pid ||
+		proc_tree[j].gen != proc_tree[i].parent_gen)
+		return false;
+	*ppid = proc_tree[i].ppid;
+	return true;
+}
+
+static void proc_tree_set(pid_t pid, pid_t ppid) {
+	ProcLink *old = proc_tree;
+	unsigned int old_size = proc_tree_size, i;
+	unsigned long parent_gen = 0;
+
+	if (proc_tree_count) {
+		i = proc_tree_slot(ppid);
+		if (proc_tree[i].pid)
+			parent_gen = proc_tree[i].gen;
+	}
+
+	if ((proc_tree_count + 1) * 2 > proc_tree_size) {
+		proc_tree_size = old_size ? old_size * 2 : 1024;
+		proc_tree = ecalloc(proc_tree_size, sizeof(*proc_tree));
+		proc_tree_count = 0;
+		for (i = 0; i < old_size; i++) {
+			if (old[i].pid) {
+				proc_tree[proc_tree_slot(old[i].pid)] = old[i];
+				proc_tree_count++;
+			}
+		}
+		free(old);
+	}
+
+	i = proc_tree_slot(pid);
+	if (!proc_tree[i].pid)
+		proc_tree_count++;
+	proc_tree[i].pid = pid;
+	proc_tree[i].ppid = ppid;
+	proc_tree[i].gen = ++proc_tree_gen;
+	proc_tree[i].parent_gen = parent_gen;
+}
+
+static void proc_tree_remove(pid_t pid) {
+	unsigned int i, j, k;
+
+	if (!proc_tree_count)
+		return;
+	i = proc_tree_slot(pid);
+	if (!proc_tree[i].pid)
+		return;
+	proc_tree[i].pid = 0;
+	proc_tree_count--;
+
+	// 把后面同一串里的项往前挪,查找时不会提前碰到空位
+	for (j = (i + 1) & (proc_tree_size - 1); proc_tree[j].pid;
+		 j = (j + 1) & (proc_tree_size - 1)) {
+		k = (unsigned int)proc_tree[j].pid * 2654435761u &
+			(proc_tree_size - 1);
+		if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+			proc_tree[i] = proc_tree[j];
+			proc_tree[j].pid = 0;
+			i = j;
+		}
+	}
+}
+
+// 进程退出后它的 pid 随时可能被复用,缓存里的记录都不能再用
+void proc_forget(pid_t pid) {
+	ProcEntry *e = &proc_cache[(unsigned int)pid % LENGTH(proc_cache)];
+
+	if (e->pid == pid)
+		e->pid = 0;
+	proc_tree_remove(pid);
+}
+
+int proc_events_handle(int fd, uint32_t mask, void *data) {
+	char buf[4096] __attribute__((aligned(NLMSG_ALIGNTO)));
+	struct nlmsghdr *nlh;
+	struct proc_event ev;
+	struct cn_msg *msg;
+	ssize_t len;
+
+	while ((len = recv(fd, buf, sizeof(buf), 0)) != 0) {
+		if (len < 0) {
+			// 内核队列溢出丢了事件,树已经不可信,之后从 /proc 重新读
+			if (errno == ENOBUFS) {
+				wlr_log(WLR_INFO, "proc connector overrun, dropping tree");
+				free(proc_tree);
+				proc_tree = NULL;
+				proc_tree_size = proc_tree_count = 0;
+				continue;
+			}
+			break;
+		}
+		for (nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+			 nlh = NLMSG_NEXT(nlh, len)) {
+			if (nlh->nlmsg_type != NLMSG_DONE)
+				continue;
+			msg = NLMSG_DATA(nlh);
+			if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC)
+				continue;
+			// cn_msg 后面的数据没有按 proc_event 对齐,复制出来再读
+			memset(&ev, 0, sizeof(ev));
+			memcpy(&ev, msg->data,
+				   msg->len < sizeof(ev) ? msg->len : sizeof(ev));
+			if (ev.what == PROC_EVENT_FORK &&
+				ev.event_data.fork.child_pid == ev.event_data.fork.child_tgid) {
+				proc_tree_set(ev.event_data.fork.child_tgid,
+							  ev.event_data.fork.parent_tgid);
+			} else if (ev.what == PROC_EVENT_EXIT &&
+					   ev.event_data.exit.process_pid ==
+						   ev.event_data.exit.process_tgid) {
+				proc_forget(ev.event_data.exit.process_tgid);
+			}
+		}
+	}
+	return 0;
+}
+
+void proc_events_finish(void) {
+	if (proc_events_source) {
+		wl_event_source_remove(proc_events_source);
+		proc_events_source = NULL;
+	}
+	if (proc_events_fd >= 0) {
+		close(proc_events_fd);
+		proc_events_fd = -1;
+	}
+	free(proc_tree);
+	proc_tree = NULL;
+	proc_tree_size = proc_tree_count = 0;
+}
+
+void proc_events_update(void) {
+	struct sockaddr_nl addr = {.nl_family = AF_NETLINK,
+							   .nl_groups = CN_IDX_PROC,
+							   .nl_pid = 0};
+	struct {
+		struct nlmsghdr nlh;
+		struct cn_msg msg;
+		enum proc_cn_mcast_op op;
+	} __attribute__((packed)) req = {0};
+
+	if (!swallow_proc_events || !event_loop) {
+		proc_events_finish();
+		return;
+	}
+	if (proc_events_fd >= 0)
+		return;
+
+	proc_events_fd = socket(
+		PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+	if (proc_events_fd < 0)
+		return;
+
+	req.nlh.nlmsg_len = sizeof(req);
+	req.nlh.nlmsg_type = NLMSG_DONE;
+	req.nlh.nlmsg_pid = getpid();
+	req.msg.id.idx = CN_IDX_PROC;
+	req.msg.id.val = CN_VAL_PROC;
+	req.msg.len = sizeof(req.op);
+	req.op = PROC_CN_MCAST_LISTEN;
+	if (bind(proc_events_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+		send(proc_events_fd, &req, sizeof(req), 0) < 0) {
+		// 普通用户一般没有权限,这不是错误
+		wlr_log(WLR_INFO,
+				"proc connector unavailable, using /proc for swallow");
+		close(proc_events_fd);
+		proc_events_fd = -1;
+		return;
+	}
+
+	proc_events_source =
+		wl_event_loop_add_fd(event_loop, proc_events_fd, WL_EVENT_READABLE,
+							 proc_events_handle, NULL);
+}
+
+int client_pidfd_handle(int fd, uint32_t mask, void *data) {
+	Client *c = data;
+
+	c->pid_exited = true;
+	proc_forget(c->pid);
+	wl_event_source_remove(c->pidfd_source);
+	c->pidfd_source = NULL;
+	close(c->pidfd);
+	return 0;
+}
+
+/* 有 proc connector 时退出事件已经能剔除终端,否则给终端窗口的进程
+ * 注册 pidfd */
+void client_watch_pid(Client *c) {
+	int fd;
+
+	c->pid_exited = false;
+	if (!c->isterm || !c->pid || c->pidfd_source || proc_events_fd >= 0 ||
+		!swallow_proc_events)
+		return;
+
+#ifdef SYS_pidfd_open
+	fd = syscall(SYS_pidfd_open, c->pid, 0);
+#else
+	fd = -1;
+#endif
+	if (fd < 0)
+		return;
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	c->pidfd = fd;
+	c->pidfd_source = wl_event_loop_add_fd(event_loop, fd, WL_EVENT_READABLE,
+										   client_pidfd_handle, c);
+	if (!c->pidfd_source)
+		close(fd);
+}
+
+void client_unwatch_pid(Client *c) {
+	if (!c->pidfd_source)
+		return;
+	wl_event_source_remove(c->pidfd_source);
+	c->pidfd_source = NULL;
+	close(c->pidfd);
+}
@@ -1,9 +1,11 @@
 /* See LICENSE.dwm file for copyright and license details. */
 #include <fcntl.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "util.h"
 
@@ -49,30 +51,331 @@ int fd_set_nonblock(int fd) {
 	return 0;
 }
 
-int regex_match(const char *pattern, const char *str) {
+/* 线性分配器:只做指针递增,整块一次释放 */
+#define ARENA_BLOCK_SIZE 16384
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+struct ArenaBlock {
+	struct ArenaBlock *next;
+	size_t size;
+	size_t used;
+	_Alignas(max_align_t) unsigned char data[];
+};
+
+void *arena_alloc(Arena *arena, size_t size) {
+	struct ArenaBlock *block = arena->head;
+	void *p;
+
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	if (!size)
+		size = ARENA_ALIGN;
+
+	if (!block || block->size - block->used < size) {
+		size_t cap = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+
+		block = malloc(sizeof(*block) + cap);
+		if (!block) {
+			arena->failed = 1;
+			return NULL;
+		}
+		block->size = cap;
+		block->used = 0;
+		/* 大块单独挂在后面,当前块剩余空间继续使用 */
+		if (arena->head && cap > ARENA_BLOCK_SIZE) {
+			block->next = arena->head->next;
+			arena->head->next = block;
+		} else {
+			block->next = arena->head;
+			arena->head = block;
+		}
+	}
+
+	p = block->data + block->used;
+	block->used += size;
+	memset(p, 0, size);
+	return p;
+}
+
+char *arena_strdup(Arena *arena, const char *str) {
+	size_t len = strlen(str) + 1;
+	char *p = arena_alloc(arena, len);
+
+	if (p)
+		memcpy(p, str, len);
+	return p;
+}
+
+static size_t arena_capacity(size_t count) {
+	size_t cap = 8;
+
+	while (cap < count)
+		cap <<= 1;
+	return cap;
+}
+
+/* 按 2 的幂扩容的数组,count 为已有元素数,返回至少能放下 count + add 个元素的指针 */
+void *arena_grow(Arena *arena, void *ptr, size_t count, size_t add,
+				 size_t size) {
+	void *p;
+
+	if (ptr && count + add <= arena_capacity(count))
+		return ptr;
+
+	p = arena_alloc(arena, arena_capacity(count + add) * size);
+	if (p && ptr)
+		memcpy(p, ptr, count * size);
+	return p;
+}
+
+void arena_free(Arena *arena) {
+	struct ArenaBlock *block, *next;
+
+	for (block = arena->head; block; block = next) {
+		next = block->next;
+		free(block);
+	}
+	if (arena->map)
+		munmap(arena->map, arena->map_size);
+	arena->head = NULL;
+	arena->map = NULL;
+	arena->map_size = 0;
+	arena->failed = 0;
+}
+
+size_t arena_used(const Arena *arena) {
+	const struct ArenaBlock *block;
+	size_t used = 0;
+
+	for (block = arena->head; block; block = block->next)
+		used += block->used;
+	return used;
+}
+
+/* 把所有块依次拼接到 dst,偏移和 arena_offset 一致 */
+void arena_copy(const Arena *arena, void *dst) {
+	const struct ArenaBlock *block;
+	unsigned char *p = dst;
+
+	for (block = arena->head; block; block = block->next) {
+		memcpy(p, block->data, block->used);
+		p += block->used;
+	}
+}
+
+long arena_offset(const Arena *arena, const void *ptr) {
+	const struct ArenaBlock *block;
+	const unsigned char *p = ptr;
+	size_t off = 0;
+
+	for (block = arena->head; block; block = block->next) {
+		if (p >= block->data && p < block->data + block->used)
+			return off + (p - block->data);
+		off += block->used;
+	}
+	return -1;
+}
+
+/* slab 池:每次向系统要一整块,切成等大的对象,释放的对象挂回空闲链表,
+ * 窗口反复开关时不会在堆上留下碎片。slab 只在 pool_finish 时释放 */
+#define POOL_SLAB_SIZE 16384
+
+struct PoolSlab {
+	struct PoolSlab *next;
+	_Alignas(max_align_t) unsigned char data[];
+};
+
+static size_t pool_object_size(const Pool *pool) {
+	size_t size = pool->size > sizeof(void *) ? pool->size : sizeof(void *);
+
+	return (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+}
+
+static size_t pool_slab_objects(const Pool *pool) {
+	size_t n = POOL_SLAB_SIZE / pool_object_size(pool);
+
+	return n ? n : 1;
+}
+
+void *pool_alloc(Pool *pool) {
+	size_t size = pool_object_size(pool), n = pool_slab_objects(pool), i;
+	struct PoolSlab *slab;
+	void *p;
+
+	if (!pool->free_list) {
+		if (!(slab = malloc(sizeof(*slab) + n * size)))
+			die("malloc:");
+		slab->next = pool->slabs;
+		pool->slabs = slab;
+		pool->slab_count++;
+		/* 倒着挂,分配时按地址顺序取 */
+		for (i = n; i > 0; i--) {
+			p = slab->data + (i - 1) * size;
+			*(void **)p = pool->free_list;
+			pool->free_list = p;
+		}
+	}
+
+	p = pool->free_list;
+	pool->free_list = *(void **)p;
+	memset(p, 0, pool->size);
+	pool->allocs++;
+	if (++pool->used > pool->high_water)
+		pool->high_water = pool->used;
+	return p;
+}
+
+void pool_free(Pool *pool, void *ptr) {
+	if (!ptr)
+		return;
+	*(void **)ptr = pool->free_list;
+	pool->free_list = ptr;
+	pool->used--;
+}
+
+/* 已经分配出来的对象槽位总数 */
+size_t pool_capacity(const Pool *pool) {
+	return pool->slab_count * pool_slab_objects(pool);
+}
+
+void pool_finish(Pool *pool) {
+	struct PoolSlab *slab, *next;
+
+	for (slab = pool->slabs; slab; slab = next) {
+		next = slab->next;
+		free(slab);
+	}
+	pool->slabs = NULL;
+	pool->free_list = NULL;
+	pool->slab_count = pool->used = 0;
+}
+
+/* 编译好的正则缓存,按模式字符串索引,由当前配置代数持有 */
+typedef struct {
+	char *pattern;
+	pcre2_code *re; /* NULL: 编译失败,避免重复编译和报错 */
+	pcre2_match_data *match_data;
+} RegexCacheEntry;
+
+#define REGEX_CACHE_MAX_ENTRIES 4096
+
+static RegexCacheEntry *regex_cache;
+static size_t regex_cache_size; /* 槽位数,2 的幂 */
+static size_t regex_cache_count;
+
+static size_t regex_hash(const char *str) {
+	size_t h = 2166136261u;
+
+	while (*str) {
+		h ^= (unsigned char)*str++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static RegexCacheEntry *regex_cache_slot(RegexCacheEntry *table, size_t size,
+										 const char *pattern) {
+	size_t i = regex_hash(pattern) & (size - 1);
+
+	while (table[i].pattern && strcmp(table[i].pattern, pattern) != 0)
+		i = (i + 1) & (size - 1);
+	return &table[i];
+}
+
+static int regex_cache_grow(void) {
+	size_t size = regex_cache_size ? regex_cache_size * 2 : 64;
+	RegexCacheEntry *table = calloc(size, sizeof(*table));
+	size_t i;
+
+	if (!table)
+		return -1;
+
+	for (i = 0; i < regex_cache_size; i++) {
+		if (regex_cache[i].pattern)
+			*regex_cache_slot(table, size, regex_cache[i].pattern) =
+				regex_cache[i];
+	}
+	free(regex_cache);
+	regex_cache = table;
+	regex_cache_size = size;
+	return 0;
+}
+
+void regex_cache_clear(void) {
+	size_t i;
+
+	for (i = 0; i < regex_cache_size; i++) {
+		if (!regex_cache[i].pattern)
+			continue;
+		pcre2_match_data_free(regex_cache[i].match_data);
+		pcre2_code_free(regex_cache[i].re);
+		free(regex_cache[i].pattern);
+	}
+	free(regex_cache);
+	regex_cache = NULL;
+	regex_cache_size = 0;
+	regex_cache_count = 0;
+}
+
+static RegexCacheEntry *regex_cache_get(const char *pattern) {
+	RegexCacheEntry *e;
 	int errnum;
 	PCRE2_SIZE erroffset;
 
-	if (!pattern || !str) {
-		return 0;
+	if (regex_cache_size) {
+		e = regex_cache_slot(regex_cache, regex_cache_size, pattern);
+		if (e->pattern)
+			return e;
 	}
 
-	pcre2_code *re = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED,
-								   PCRE2_UTF, // 启用 UTF-8 支持
-								   &errnum, &erroffset, NULL);
-	if (!re) {
+	/* patterns can also come from ipc dispatch, keep the cache bounded */
+	if (regex_cache_count >= REGEX_CACHE_MAX_ENTRIES)
+		regex_cache_clear();
+	if ((regex_cache_count + 1) * 4 > regex_cache_size * 3 &&
+		regex_cache_grow() < 0)
+		return NULL;
+
+	e = regex_cache_slot(regex_cache, regex_cache_size, pattern);
+	e->pattern = strdup(pattern);
+	if (!e->pattern)
+		return NULL;
+	regex_cache_count++;
+
+	e->re = pcre2_compile((PCRE2_SPTR)pattern, PCRE2_ZERO_TERMINATED,
+						  PCRE2_UTF, // 启用 UTF-8 支持
+						  &errnum, &erroffset, NULL);
+	if (!e->re) {
 		PCRE2_UCHAR errbuf[256];
 		pcre2_get_error_message(errnum, errbuf, sizeof(errbuf));
 		fprintf(stderr, "PCRE2 error: %s at offset %zu\n", errbuf, erroffset);
+		return e;
+	}
+
+	/* JIT 不可用时 pcre2_match 会自动回退到解释器 */
+	pcre2_jit_compile(e->re, PCRE2_JIT_COMPLETE);
+	e->match_data = pcre2_match_data_create_from_pattern(e->re, NULL);
+	if (!e->match_data) {
+		pcre2_code_free(e->re);
+		e->re = NULL;
+	}
+	return e;
+}
+
+void regex_cache_add(const char *pattern) {
+	if (pattern)
+		regex_cache_get(pattern);
+}
+
+int regex_match(const char *pattern, const char *str) {
+	RegexCacheEntry *e;
+
+	if (!pattern || !str) {
 		return 0;
 	}
 
-	pcre2_match_data *match_data =
-		pcre2_match_data_create_from_pattern(re, NULL);
-	int ret =
-		pcre2_match(re, (PCRE2_SPTR)str, strlen(str), 0, 0, match_data, NULL);
+	e = regex_cache_get(pattern);
+	if (!e || !e->re)
+		return 0;
 
-	pcre2_match_data_free(match_data);
-	pcre2_code_free(re);
-	return ret >= 0;
+	return pcre2_match(e->re, (PCRE2_SPTR)str, strlen(str), 0, 0,
+					   e->match_data, NULL) >= 0;
 }
@@ -1,6 +1,39 @@
 /* See LICENSE.dwm file for copyright and license details. */
 
+typedef struct {
+	struct ArenaBlock *head;
+	int failed;		 /* 有分配失败过,内容不完整 */
+	void *map;		 /* 从缓存文件映射进来的内容,随 arena 一起释放 */
+	size_t map_size;
+} Arena;
+
+/* 固定大小对象的 slab 池,释放的对象挂在空闲链表上给下次分配复用 */
+typedef struct {
+	const char *name;
+	size_t size;		/* 对象大小 */
+	struct PoolSlab *slabs;
+	void *free_list;
+	size_t slab_count;	/* 已经向系统要的 slab 数 */
+	size_t used;		/* 正在使用的对象数 */
+	size_t high_water;	/* used 的最大值 */
+	unsigned long allocs; /* 累计分配次数 */
+} Pool;
+
 void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
 int fd_set_nonblock(int fd);
 int regex_match(const char *pattern_mb, const char *str_mb);
+void regex_cache_add(const char *pattern);
+void regex_cache_clear(void);
+void *arena_alloc(Arena *arena, size_t size);
+char *arena_strdup(Arena *arena, const char *str);
+void *arena_grow(Arena *arena, void *ptr, size_t count, size_t add,
+				 size_t size);
+void arena_free(Arena *arena);
+size_t arena_used(const Arena *arena);
+void arena_copy(const Arena *arena, void *dst);
+long arena_offset(const Arena *arena, const void *ptr);
+void *pool_alloc(Pool *pool);
+void pool_free(Pool *pool, void *ptr);
+size_t pool_capacity(const Pool *pool);
+void pool_finish(Pool *pool);
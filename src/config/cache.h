@@ -0,0 +1,429 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+// 解析好的配置直接序列化到 $XDG_CACHE_HOME/maomao,启动时映射进来跳过解析
+// 文件布局: 头 | Config | xkb 规则名 | 烘焙好的曲线 | arena 内容
+// 指针按 arena 内偏移或相对 config 的偏移保存,加载后原地重定位
+
+#define CONFIG_CACHE_MAGIC "MAOCFG\0\1"
+#define CONFIG_CACHE_VERSION 1
+#define CONFIG_CACHE_ALIGN 64
+
+#define CONFIG_CACHE_PTR_DATA 1u   // arena 内偏移
+#define CONFIG_CACHE_PTR_STATIC 2u // 程序内的函数和字符串常量
+
+#define CONFIG_CACHE_ALIGN_UP(x)                                               \
+	(((x) + CONFIG_CACHE_ALIGN - 1) & ~(size_t)(CONFIG_CACHE_ALIGN - 1))
+#define CONFIG_CACHE_CONFIG_OFF CONFIG_CACHE_ALIGN_UP(sizeof(ConfigCacheHeader))
+#define CONFIG_CACHE_XKB_OFF                                                   \
+	CONFIG_CACHE_ALIGN_UP(CONFIG_CACHE_CONFIG_OFF + sizeof(Config))
+#define CONFIG_CACHE_BAKED_OFF                                                 \
+	CONFIG_CACHE_ALIGN_UP(CONFIG_CACHE_XKB_OFF + 5 * 256)
+#define CONFIG_CACHE_BAKED_SIZE (4 * BAKED_POINTS_COUNT * sizeof(struct dvec2))
+#define CONFIG_CACHE_DATA_OFF                                                  \
+	CONFIG_CACHE_ALIGN_UP(CONFIG_CACHE_BAKED_OFF + CONFIG_CACHE_BAKED_SIZE)
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t config_size;
+	int64_t exe_size; // 缓存里有函数指针,只对同一个可执行文件有效
+	int64_t exe_mtime;
+	uint64_t data_size;
+	uint64_t checksum; // 头之后所有内容的 FNV-1a
+} ConfigCacheHeader;
+
+typedef void *(*ConfigCacheFix)(void **ptr, void *data);
+
+typedef struct {
+	const Arena *arena;
+	unsigned char *base; // 保存时是 arena 的拷贝,加载时是映射的 arena 内容
+	size_t size;
+	bool bad;
+} ConfigCacheReloc;
+
+static uint64_t config_cache_checksum(const unsigned char *p, size_t len) {
+	uint64_t h = 14695981039346656037ull;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+static bool config_cache_path(const char *config_file, char *buf,
+							  size_t size) {
+	const char *cache_home = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	uint64_t h = config_cache_checksum((const unsigned char *)config_file,
+									   strlen(config_file));
+	int n;
+
+	if (cache_home && cache_home[0] == '/')
+		n = snprintf(buf, size, "%s/maomao/config-%016llx.bin", cache_home,
+					 (unsigned long long)h);
+	else if (home)
+		n = snprintf(buf, size, "%s/.cache/maomao/config-%016llx.bin", home,
+					 (unsigned long long)h);
+	else
+		return false;
+	return n > 0 && (size_t)n < size;
+}
+
+static bool config_cache_exe(int64_t *size, int64_t *mtime) {
+	struct stat st;
+
+	if (stat("/proc/self/exe", &st) != 0)
+		return false;
+	*size = st.st_size;
+	*mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+	return true;
+}
+
+static void *config_cache_encode(void **ptr, void *data) {
+	ConfigCacheReloc *r = data;
+	uintptr_t *slot = (uintptr_t *)ptr;
+	long off;
+
+	if (!*ptr)
+		return NULL;
+	off = arena_offset(r->arena, *ptr);
+	if (off < 0) {
+		*slot = ((uintptr_t)*ptr - (uintptr_t)&config) * 4 +
+				CONFIG_CACHE_PTR_STATIC;
+		return NULL;
+	}
+	*slot = (uintptr_t)off * 4 + CONFIG_CACHE_PTR_DATA;
+	return r->base + off;
+}
+
+static void *config_cache_decode(void **ptr, void *data) {
+	ConfigCacheReloc *r = data;
+	uintptr_t v = *(uintptr_t *)ptr;
+	uintptr_t off = v / 4;
+
+	if (!v)
+		return NULL;
+	if ((v & 3) == CONFIG_CACHE_PTR_STATIC) {
+		*ptr = (char *)&config + (intptr_t)(v & ~(uintptr_t)3) / 4;
+		return NULL;
+	}
+	if ((v & 3) != CONFIG_CACHE_PTR_DATA || off >= r->size) {
+		r->bad = true;
+		*ptr = NULL;
+		return NULL;
+	}
+	*ptr = r->base + off;
+	return *ptr;
+}
+
+static void config_cache_fix_arg(Arg *arg, ConfigCacheFix fix, void *data) {
+	fix((void **)&arg->v, data);
+	fix((void **)&arg->v2, data);
+	fix((void **)&arg->v3, data);
+}
+
+static void config_cache_fix_index(KeyBindingIndex *index, ConfigCacheFix fix,
+								   void *data) {
+	fix((void **)&index->heads, data);
+	fix((void **)&index->next, data);
+}
+
+// 依次处理 Config 里的每个指针,fix 返回指向的内容在当前缓冲区里的位置
+static void config_cache_relocate(Config *c, ConfigCacheFix fix, void *data) {
+	ConfigTagRule *tag_rules;
+	ConfigWinRule *rules;
+	WinRuleFilter *filters;
+	ConfigMonitorRule *mon_rules;
+	KeyBinding *keys;
+	MouseBinding *mouse;
+	AxisBinding *axis;
+	GestureBinding *gestures;
+	ConfigEnv *env;
+	ConfigSource *sources;
+	char **strs;
+	int i;
+
+	fix((void **)&c->scroller_proportion_preset, data);
+	if ((strs = fix((void **)&c->circle_layout, data))) {
+		for (i = 0; i < c->circle_layout_count; i++)
+			fix((void **)&strs[i], data);
+	}
+	if ((tag_rules = fix((void **)&c->tag_rules, data))) {
+		for (i = 0; i < c->tag_rules_count; i++)
+			fix((void **)&tag_rules[i].layout_name, data);
+	}
+	if ((rules = fix((void **)&c->window_rules, data))) {
+		for (i = 0; i < c->window_rules_count; i++) {
+			fix((void **)&rules[i].id, data);
+			fix((void **)&rules[i].title, data);
+			fix((void **)&rules[i].animation_type_open, data);
+			fix((void **)&rules[i].animation_type_close, data);
+			fix((void **)&rules[i].globalkeybinding.func, data);
+			config_cache_fix_arg(&rules[i].globalkeybinding.arg, fix, data);
+		}
+	}
+	if ((filters = fix((void **)&c->window_rule_filters, data))) {
+		for (i = 0; i < c->rule_slots_count; i++) {
+			fix((void **)&filters[i].id, data);
+			fix((void **)&filters[i].title, data);
+			fix((void **)&filters[i].arg, data);
+			fix((void **)&filters[i].id_literal, data);
+			fix((void **)&filters[i].title_literal, data);
+		}
+	}
+	config_cache_fix_index(&c->window_rule_exact_index, fix, data);
+	fix((void **)&c->window_rule_scan, data);
+	config_cache_fix_index(&c->globalkey_keysym_index, fix, data);
+	config_cache_fix_index(&c->globalkey_keycode_index, fix, data);
+	if ((mon_rules = fix((void **)&c->monitor_rules, data))) {
+		for (i = 0; i < c->monitor_rules_count; i++) {
+			fix((void **)&mon_rules[i].name, data);
+			fix((void **)&mon_rules[i].layout, data);
+		}
+	}
+	if ((keys = fix((void **)&c->key_bindings, data))) {
+		for (i = 0; i < c->key_bindings_count; i++) {
+			fix((void **)&keys[i].func, data);
+			config_cache_fix_arg(&keys[i].arg, fix, data);
+		}
+	}
+	config_cache_fix_index(&c->keysym_index, fix, data);
+	config_cache_fix_index(&c->keycode_index, fix, data);
+	if ((mouse = fix((void **)&c->mouse_bindings, data))) {
+		for (i = 0; i < c->mouse_bindings_count; i++) {
+			fix((void **)&mouse[i].func, data);
+			config_cache_fix_arg(&mouse[i].arg, fix, data);
+		}
+	}
+	if ((axis = fix((void **)&c->axis_bindings, data))) {
+		for (i = 0; i < c->axis_bindings_count; i++) {
+			fix((void **)&axis[i].func, data);
+			config_cache_fix_arg(&axis[i].arg, fix, data);
+		}
+	}
+	if ((gestures = fix((void **)&c->gesture_bindings, data))) {
+		for (i = 0; i < c->gesture_bindings_count; i++) {
+			fix((void **)&gestures[i].func, data);
+			config_cache_fix_arg(&gestures[i].arg, fix, data);
+		}
+	}
+	if ((strs = fix((void **)&c->exec, data))) {
+		for (i = 0; i < c->exec_count; i++)
+			fix((void **)&strs[i], data);
+	}
+	if ((strs = fix((void **)&c->exec_once, data))) {
+		for (i = 0; i < c->exec_once_count; i++)
+			fix((void **)&strs[i], data);
+	}
+	fix((void **)&c->cursor_theme, data);
+	fix((void **)&c->xkb_rules.rules, data);
+	fix((void **)&c->xkb_rules.model, data);
+	fix((void **)&c->xkb_rules.layout, data);
+	fix((void **)&c->xkb_rules.variant, data);
+	fix((void **)&c->xkb_rules.options, data);
+	if ((env = fix((void **)&c->env, data))) {
+		for (i = 0; i < c->env_count; i++) {
+			fix((void **)&env[i].name, data);
+			fix((void **)&env[i].value, data);
+		}
+	}
+	if ((sources = fix((void **)&c->sources, data))) {
+		for (i = 0; i < c->sources_count; i++)
+			fix((void **)&sources[i].path, data);
+	}
+}
+
+// 缓存里记录的配置文件都没有变化才算有效
+static bool config_cache_sources_valid(const Config *c,
+									   const char *config_file) {
+	struct stat st;
+	int i;
+
+	if (c->sources_count < 1 || !c->sources[0].path ||
+		strcmp(c->sources[0].path, config_file) != 0)
+		return false;
+
+	for (i = 0; i < c->sources_count; i++) {
+		if (!c->sources[i].path)
+			return false;
+		if (stat(c->sources[i].path, &st) != 0) {
+			if (c->sources[i].size != -1)
+				return false;
+			continue;
+		}
+		if (c->sources[i].size != st.st_size ||
+			c->sources[i].mtime !=
+				st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec)
+			return false;
+	}
+	return true;
+}
+
+bool config_cache_load(const char *config_file) {
+	char path[PATH_MAX];
+	const ConfigCacheHeader *hdr;
+	ConfigCacheReloc r = {0};
+	unsigned char *map;
+	int64_t exe_size, exe_mtime;
+	struct stat st;
+	Config c;
+	int fd, i;
+
+	if (config_file[0] != '/' || !config_cache_path(config_file, path,
+													sizeof(path)) ||
+		!config_cache_exe(&exe_size, &exe_mtime))
+		return false;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) != 0 || (size_t)st.st_size < CONFIG_CACHE_DATA_OFF) {
+		close(fd);
+		return false;
+	}
+	// 私有可写映射,重定位只改动用到的页
+	map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	hdr = (const ConfigCacheHeader *)map;
+	if (memcmp(hdr->magic, CONFIG_CACHE_MAGIC, sizeof(hdr->magic)) != 0 ||
+		hdr->version != CONFIG_CACHE_VERSION ||
+		hdr->config_size != sizeof(Config) || hdr->exe_size != exe_size ||
+		hdr->exe_mtime != exe_mtime ||
+		hdr->data_size != st.st_size - CONFIG_CACHE_DATA_OFF ||
+		hdr->checksum !=
+			config_cache_checksum(map + sizeof(*hdr),
+								  st.st_size - sizeof(*hdr)))
+		goto fail;
+
+	memcpy(&c, map + CONFIG_CACHE_CONFIG_OFF, sizeof(c));
+	r.base = map + CONFIG_CACHE_DATA_OFF;
+	r.size = hdr->data_size;
+	config_cache_relocate(&c, config_cache_decode, &r);
+	if (r.bad || !config_cache_sources_valid(&c, config_file))
+		goto fail;
+
+	c.baked_points = (struct dvec2 *)(map + CONFIG_CACHE_BAKED_OFF);
+	c.arena = (Arena){.map = map, .map_size = st.st_size};
+	config = c;
+
+	memcpy(xkb_rules_rules, map + CONFIG_CACHE_XKB_OFF, 256);
+	memcpy(xkb_rules_model, map + CONFIG_CACHE_XKB_OFF + 256, 256);
+	memcpy(xkb_rules_layout, map + CONFIG_CACHE_XKB_OFF + 512, 256);
+	memcpy(xkb_rules_variant, map + CONFIG_CACHE_XKB_OFF + 768, 256);
+	memcpy(xkb_rules_options, map + CONFIG_CACHE_XKB_OFF + 1024, 256);
+	for (i = 0; i < config.env_count; i++)
+		setenv(config.env[i].name, config.env[i].value, 1);
+	return true;
+
+fail:
+	munmap(map, st.st_size);
+	return false;
+}
+
+static bool config_cache_write_all(int fd, const void *buf, size_t len) {
+	const unsigned char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, p, len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+// 写到临时文件再 rename,别的实例不会读到写了一半的缓存
+void config_cache_save(void) {
+	char path[PATH_MAX], tmp[PATH_MAX + 32], *slash;
+	ConfigCacheHeader *hdr;
+	ConfigCacheReloc r = {0};
+	unsigned char *buf;
+	size_t data_size, size, baked_size;
+	Config c;
+	int fd;
+	bool ok;
+
+	// 配置本身就是从缓存加载的,不用再写
+	if (config.baked_points || !baked_points_move)
+		return;
+
+	if (config.sources_count < 1 ||
+		!config_cache_path(config.sources[0].path, path, sizeof(path)))
+		return;
+
+	data_size = arena_used(&config.arena);
+	size = CONFIG_CACHE_DATA_OFF + data_size;
+	buf = calloc(1, size);
+	if (!buf)
+		return;
+
+	hdr = (ConfigCacheHeader *)buf;
+	memcpy(hdr->magic, CONFIG_CACHE_MAGIC, sizeof(hdr->magic));
+	hdr->version = CONFIG_CACHE_VERSION;
+	hdr->config_size = sizeof(Config);
+	hdr->data_size = data_size;
+	if (!config_cache_exe(&hdr->exe_size, &hdr->exe_mtime)) {
+		free(buf);
+		return;
+	}
+
+	r.arena = &config.arena;
+	r.base = buf + CONFIG_CACHE_DATA_OFF;
+	r.size = data_size;
+	arena_copy(&config.arena, r.base);
+	c = config;
+	config_cache_relocate(&c, config_cache_encode, &r);
+	c.baked_points = NULL;
+	c.arena = (Arena){0};
+	memcpy(buf + CONFIG_CACHE_CONFIG_OFF, &c, sizeof(c));
+
+	memcpy(buf + CONFIG_CACHE_XKB_OFF, xkb_rules_rules, 256);
+	memcpy(buf + CONFIG_CACHE_XKB_OFF + 256, xkb_rules_model, 256);
+	memcpy(buf + CONFIG_CACHE_XKB_OFF + 512, xkb_rules_layout, 256);
+	memcpy(buf + CONFIG_CACHE_XKB_OFF + 768, xkb_rules_variant, 256);
+	memcpy(buf + CONFIG_CACHE_XKB_OFF + 1024, xkb_rules_options, 256);
+
+	baked_size = BAKED_POINTS_COUNT * sizeof(struct dvec2);
+	memcpy(buf + CONFIG_CACHE_BAKED_OFF, baked_points_move, baked_size);
+	memcpy(buf + CONFIG_CACHE_BAKED_OFF + baked_size, baked_points_open,
+		   baked_size);
+	memcpy(buf + CONFIG_CACHE_BAKED_OFF + 2 * baked_size, baked_points_tag,
+		   baked_size);
+	memcpy(buf + CONFIG_CACHE_BAKED_OFF + 3 * baked_size, baked_points_close,
+		   baked_size);
+
+	hdr->checksum =
+		config_cache_checksum(buf + sizeof(*hdr), size - sizeof(*hdr));
+
+	// 逐级创建缓存目录
+	for (slash = strchr(path + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+		*slash = '\0';
+		mkdir(path, 0700);
+		*slash = '/';
+	}
+
+	snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		free(buf);
+		return;
+	}
+	ok = config_cache_write_all(fd, buf, size);
+	ok = close(fd) == 0 && ok;
+	if (!ok || rename(tmp, path) != 0) {
+		fprintf(stderr, "Error: Failed to write config cache %s\n", path);
+		unlink(tmp);
+	}
+	free(buf);
+}
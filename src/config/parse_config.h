@@ -1,7 +1,9 @@
 #include <ctype.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #ifndef SYSCONFDIR
 #define SYSCONFDIR "/etc"
@@ -33,6 +35,13 @@ typedef struct {
 	Arg arg;
 } KeyBinding;
 
+// 按键绑定哈希索引,桶内按绑定下标升序串成链表
+typedef struct {
+	int *heads;	   // 每个桶的第一个绑定下标,-1 表示空
+	int *next;	   // 同一个桶里的下一个绑定下标
+	uint32_t mask; // 桶数量 - 1
+} KeyBindingIndex;
+
 typedef struct {
 	const char *id;
 	const char *title;
@@ -65,6 +74,16 @@ typedef struct {
 	KeyBinding globalkeybinding;
 } ConfigWinRule;
 
+// 规则槽位: 先是 window_rules,后面接 toggle_named_scratchpad 绑定
+typedef struct {
+	const char *id;		 // 指向配置里的正则,NULL 表示不限制
+	const char *title;	 //
+	const Arg *arg;		 // named scratchpad 槽位对应的绑定参数
+	char *id_literal;	 // id 正则里必然出现的字面量,NULL 表示无法预筛
+	char *title_literal; // title 正则里必然出现的字面量
+	bool id_exact;		 // id 形如 ^literal$,可以直接按 appid 查表
+} WinRuleFilter;
+
 typedef struct {
 	const char *name;	// 显示器名称
 	float mfact;		// 主区域比例
@@ -114,6 +133,18 @@ typedef struct {
 	Arg arg;
 } GestureBinding;
 
+typedef struct {
+	char *name;
+	char *value;
+} ConfigEnv;
+
+// 解析过的配置文件,用来判断编译缓存是否过期
+typedef struct {
+	char *path;	   // 绝对路径
+	int64_t size;  // -1 表示文件不存在
+	int64_t mtime; // 纳秒
+} ConfigSource;
+
 typedef struct {
 	int id;			   // 标签ID (1-9)
 	char *layout_name; // 布局名称
@@ -214,12 +245,21 @@ typedef struct {
 
 	ConfigWinRule *window_rules;
 	int window_rules_count;
+	WinRuleFilter *window_rule_filters;
+	int rule_slots_count; // window_rules_count + named scratchpad 绑定数
+	KeyBindingIndex window_rule_exact_index; // 精确 appid 字面量 -> 规则
+	int *window_rule_scan; // id 不是精确字面量的规则,需要逐条检查
+	int window_rule_scan_count;
+	KeyBindingIndex globalkey_keysym_index;	 // globalkeybinding: mod + keysym
+	KeyBindingIndex globalkey_keycode_index; // globalkeybinding: mod + keycode
 
 	ConfigMonitorRule *monitor_rules; // 动态数组
 	int monitor_rules_count;		  // 条数
 
 	KeyBinding *key_bindings;
 	int key_bindings_count;
+	KeyBindingIndex keysym_index;  // CLEANMASK(mod) + normalize_keysym(sym)
+	KeyBindingIndex keycode_index; // CLEANMASK(mod) + keycode
 
 	MouseBinding *mouse_bindings;
 	int mouse_bindings_count;
@@ -242,14 +282,28 @@ typedef struct {
 	int single_scratchpad;
 	int xwayland_persistence;
 	int syncobj_enable;
+	int config_autoreload;
+	int swallow_proc_events;
 
 	struct xkb_rule_names xkb_rules;
+
+	ConfigEnv *env; // env 设置,从缓存加载时重新 setenv
+	int env_count;
+
+	ConfigSource *sources; // 第一个是主配置文件
+	int sources_count;
+
+	struct dvec2 *baked_points; // 缓存里烘焙好的 move/open/tag/close 曲线
+
+	Arena arena; // 本代配置的所有动态内存,重载时整体释放
 } Config;
 
 typedef void (*FuncType)(const Arg *);
 Config config;
+char config_path[1024]; // 最近一次解析的主配置文件路径
+unsigned int config_generation = 0; // 每次解析配置后递增
 
-void parse_config_file(Config *config, const char *file_path);
+bool parse_config_file(Config *config, const char *file_path);
 
 // Helper function to trim whitespace from start and end of a string
 void trim_whitespace(char *str) {
@@ -707,9 +761,11 @@ FuncType parse_func_name(char *func_name, Arg *arg, char *arg_value,
 	} else if (strcmp(func_name, "spawn") == 0) {
 		func = spawn;
 		(*arg).v = strdup(arg_value);
+		(*arg).v2 = spawn_tokenize(arg_value);
 	} else if (strcmp(func_name, "spawn_on_empty") == 0) {
 		func = spawn_on_empty;
 		(*arg).v = strdup(arg_value); // 注意：之后需要释放这个内存
+		(*arg).v2 = spawn_tokenize(arg_value);
 		(*arg).ui = 1 << (atoi(arg_value2) - 1);
 	} else if (strcmp(func_name, "quit") == 0) {
 		func = quit;
@@ -775,141 +831,323 @@ FuncType parse_func_name(char *func_name, Arg *arg, char *arg_value,
 	return func;
 }
 
+// 放进启动队列,在事件循环里依次启动
 void run_exec() {
-	Arg arg;
-
-	for (int i = 0; i < config.exec_count; i++) {
-		arg.v = config.exec[i];
-		spawn(&arg);
-	}
+	for (int i = 0; i < config.exec_count; i++)
+		startup_queue_push(config.exec[i], false);
 }
 
 void run_exec_once() {
-	Arg arg;
+	for (int i = 0; i < config.exec_once_count; i++)
+		startup_queue_push(config.exec_once[i], false);
+}
+
+enum {
+	CONFIG_INT,
+	CONFIG_UINT,
+	CONFIG_FLOAT,
+	CONFIG_DOUBLE,
+	CONFIG_CUSTOM, // 需要专门解析的键,由 parse_config_line 里的分支处理
+};
+
+// CONFIG_CUSTOM 键的编号
+enum {
+	CFG_KEY_NONE,
+	CFG_KEY_ANIMATION_TYPE_OPEN,
+	CFG_KEY_ANIMATION_TYPE_CLOSE,
+	CFG_KEY_ANIMATION_CURVE_MOVE,
+	CFG_KEY_ANIMATION_CURVE_OPEN,
+	CFG_KEY_ANIMATION_CURVE_TAG,
+	CFG_KEY_ANIMATION_CURVE_CLOSE,
+	CFG_KEY_XKB_RULES_RULES,
+	CFG_KEY_XKB_RULES_MODEL,
+	CFG_KEY_XKB_RULES_LAYOUT,
+	CFG_KEY_XKB_RULES_VARIANT,
+	CFG_KEY_XKB_RULES_OPTIONS,
+	CFG_KEY_SCROLLER_PROPORTION_PRESET,
+	CFG_KEY_CIRCLE_LAYOUT,
+	CFG_KEY_CURSOR_THEME,
+	CFG_KEY_ROOTCOLOR,
+	CFG_KEY_BORDERCOLOR,
+	CFG_KEY_FOCUSCOLOR,
+	CFG_KEY_MAXMIZESCREENCOLOR,
+	CFG_KEY_URGENTCOLOR,
+	CFG_KEY_SCRATCHPADCOLOR,
+	CFG_KEY_GLOBALCOLOR,
+	CFG_KEY_OVERLAYCOLOR,
+	CFG_KEY_AUTOSTART,
+	CFG_KEY_TAGRULE,
+	CFG_KEY_WINDOWRULE,
+	CFG_KEY_MONITORRULE,
+	CFG_KEY_EXEC,
+	CFG_KEY_ENV,
+	CFG_KEY_EXEC_ONCE,
+	CFG_KEY_BIND,
+	CFG_KEY_MOUSEBIND,
+	CFG_KEY_AXISBIND,
+	CFG_KEY_GESTUREBIND,
+	CFG_KEY_SOURCE,
+};
+
+typedef struct {
+	const char *name;
+	int type;
+	size_t offset; // 字段在 Config 里的偏移
+	int id;		   // CONFIG_CUSTOM 时的键编号
+} ConfigKey;
+
+#define CONFIG_FIELD(field, type) {#field, type, offsetof(Config, field), 0}
+#define CONFIG_CUSTOM_KEY(name, id) {name, CONFIG_CUSTOM, 0, id}
+
+// 按 strcmp 顺序排列,供 bsearch 查找,新增键时注意保持有序
+static const ConfigKey config_keys[] = {
+	CONFIG_FIELD(accel_profile, CONFIG_UINT),
+	CONFIG_FIELD(accel_speed, CONFIG_DOUBLE),
+	CONFIG_CUSTOM_KEY("animation_curve_close", CFG_KEY_ANIMATION_CURVE_CLOSE),
+	CONFIG_CUSTOM_KEY("animation_curve_move", CFG_KEY_ANIMATION_CURVE_MOVE),
+	CONFIG_CUSTOM_KEY("animation_curve_open", CFG_KEY_ANIMATION_CURVE_OPEN),
+	CONFIG_CUSTOM_KEY("animation_curve_tag", CFG_KEY_ANIMATION_CURVE_TAG),
+	CONFIG_FIELD(animation_duration_close, CONFIG_UINT),
+	CONFIG_FIELD(animation_duration_move, CONFIG_UINT),
+	CONFIG_FIELD(animation_duration_open, CONFIG_UINT),
+	CONFIG_FIELD(animation_duration_tag, CONFIG_UINT),
+	CONFIG_FIELD(animation_fade_in, CONFIG_INT),
+	CONFIG_FIELD(animation_fade_out, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("animation_type_close", CFG_KEY_ANIMATION_TYPE_CLOSE),
+	CONFIG_CUSTOM_KEY("animation_type_open", CFG_KEY_ANIMATION_TYPE_OPEN),
+	CONFIG_FIELD(animations, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("autostart", CFG_KEY_AUTOSTART),
+	CONFIG_FIELD(axis_bind_apply_timeout, CONFIG_UINT),
+	CONFIG_CUSTOM_KEY("bordercolor", CFG_KEY_BORDERCOLOR),
+	CONFIG_FIELD(borderpx, CONFIG_UINT),
+	CONFIG_FIELD(bypass_surface_visibility, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("circle_layout", CFG_KEY_CIRCLE_LAYOUT),
+	CONFIG_FIELD(config_autoreload, CONFIG_INT),
+	CONFIG_FIELD(cursor_hide_timeout, CONFIG_UINT),
+	CONFIG_FIELD(cursor_size, CONFIG_UINT),
+	CONFIG_CUSTOM_KEY("cursor_theme", CFG_KEY_CURSOR_THEME),
+	CONFIG_FIELD(default_mfact, CONFIG_FLOAT),
+	CONFIG_FIELD(default_nmaster, CONFIG_UINT),
+	CONFIG_FIELD(default_smfact, CONFIG_FLOAT),
+	CONFIG_FIELD(disable_while_typing, CONFIG_INT),
+	CONFIG_FIELD(drag_lock, CONFIG_INT),
+	CONFIG_FIELD(drag_tile_to_tile, CONFIG_INT),
+	CONFIG_FIELD(enable_floating_snap, CONFIG_INT),
+	CONFIG_FIELD(enable_hotarea, CONFIG_UINT),
+	CONFIG_CUSTOM_KEY("exec", CFG_KEY_EXEC),
+	CONFIG_FIELD(fadein_begin_opacity, CONFIG_FLOAT),
+	CONFIG_FIELD(fadeout_begin_opacity, CONFIG_FLOAT),
+	CONFIG_FIELD(focus_cross_monitor, CONFIG_INT),
+	CONFIG_FIELD(focus_cross_tag, CONFIG_INT),
+	CONFIG_FIELD(focus_on_activate, CONFIG_UINT),
+	CONFIG_CUSTOM_KEY("focuscolor", CFG_KEY_FOCUSCOLOR),
+	CONFIG_FIELD(gappih, CONFIG_UINT),
+	CONFIG_FIELD(gappiv, CONFIG_UINT),
+	CONFIG_FIELD(gappoh, CONFIG_UINT),
+	CONFIG_FIELD(gappov, CONFIG_UINT),
+	CONFIG_CUSTOM_KEY("globalcolor", CFG_KEY_GLOBALCOLOR),
+	CONFIG_FIELD(hotarea_size, CONFIG_UINT),
+	CONFIG_FIELD(left_handed, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("maxmizescreencolor", CFG_KEY_MAXMIZESCREENCOLOR),
+	CONFIG_FIELD(middle_button_emulation, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("monitorrule", CFG_KEY_MONITORRULE),
+	CONFIG_FIELD(mouse_natural_scrolling, CONFIG_INT),
+	CONFIG_FIELD(new_is_master, CONFIG_UINT),
+	CONFIG_FIELD(no_border_when_single, CONFIG_INT),
+	CONFIG_FIELD(numlockon, CONFIG_UINT),
+	CONFIG_FIELD(ov_tab_mode, CONFIG_UINT),
+	CONFIG_CUSTOM_KEY("overlaycolor", CFG_KEY_OVERLAYCOLOR),
+	CONFIG_FIELD(overviewgappi, CONFIG_INT),
+	CONFIG_FIELD(overviewgappo, CONFIG_INT),
+	CONFIG_FIELD(repeat_delay, CONFIG_INT),
+	CONFIG_FIELD(repeat_rate, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("rootcolor", CFG_KEY_ROOTCOLOR),
+	CONFIG_CUSTOM_KEY("scratchpadcolor", CFG_KEY_SCRATCHPADCOLOR),
+	CONFIG_FIELD(scroller_default_proportion, CONFIG_FLOAT),
+	CONFIG_FIELD(scroller_default_proportion_single, CONFIG_FLOAT),
+	CONFIG_FIELD(scroller_focus_center, CONFIG_INT),
+	CONFIG_FIELD(scroller_prefer_center, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("scroller_proportion_preset", CFG_KEY_SCROLLER_PROPORTION_PRESET),
+	CONFIG_FIELD(scroller_structs, CONFIG_INT),
+	CONFIG_FIELD(single_scratchpad, CONFIG_INT),
+	CONFIG_FIELD(sloppyfocus, CONFIG_INT),
+	CONFIG_FIELD(smartgaps, CONFIG_INT),
+	CONFIG_FIELD(snap_distance, CONFIG_INT),
+	CONFIG_FIELD(swallow_proc_events, CONFIG_INT),
+	CONFIG_FIELD(swipe_min_threshold, CONFIG_UINT),
+	CONFIG_FIELD(syncobj_enable, CONFIG_INT),
+	CONFIG_FIELD(tag_animation_direction, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("tagrule", CFG_KEY_TAGRULE),
+	CONFIG_FIELD(tap_and_drag, CONFIG_INT),
+	CONFIG_FIELD(tap_to_click, CONFIG_INT),
+	CONFIG_FIELD(trackpad_natural_scrolling, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("urgentcolor", CFG_KEY_URGENTCOLOR),
+	CONFIG_FIELD(warpcursor, CONFIG_INT),
+	CONFIG_CUSTOM_KEY("windowrule", CFG_KEY_WINDOWRULE),
+	CONFIG_CUSTOM_KEY("xkb_rules_layout", CFG_KEY_XKB_RULES_LAYOUT),
+	CONFIG_CUSTOM_KEY("xkb_rules_model", CFG_KEY_XKB_RULES_MODEL),
+	CONFIG_CUSTOM_KEY("xkb_rules_options", CFG_KEY_XKB_RULES_OPTIONS),
+	CONFIG_CUSTOM_KEY("xkb_rules_rules", CFG_KEY_XKB_RULES_RULES),
+	CONFIG_CUSTOM_KEY("xkb_rules_variant", CFG_KEY_XKB_RULES_VARIANT),
+	CONFIG_FIELD(xwayland_persistence, CONFIG_INT),
+	CONFIG_FIELD(zoom_initial_ratio, CONFIG_FLOAT),
+};
+
+static int config_key_cmp(const void *key, const void *entry) {
+	return strcmp(key, ((const ConfigKey *)entry)->name);
+}
+
+// 以前缀区分的键(bind/bindl/bindsym...),按原来的判断顺序匹配
+static int config_key_prefix_id(const char *key) {
+	if (strncmp(key, "env", 3) == 0)
+		return CFG_KEY_ENV;
+	if (strncmp(key, "exec-once", 9) == 0)
+		return CFG_KEY_EXEC_ONCE;
+	if (strncmp(key, "bind", 4) == 0)
+		return CFG_KEY_BIND;
+	if (strncmp(key, "mousebind", 9) == 0)
+		return CFG_KEY_MOUSEBIND;
+	if (strncmp(key, "axisbind", 8) == 0)
+		return CFG_KEY_AXISBIND;
+	if (strncmp(key, "gesturebind", 11) == 0)
+		return CFG_KEY_GESTUREBIND;
+	if (strncmp(key, "source", 6) == 0)
+		return CFG_KEY_SOURCE;
+	return CFG_KEY_NONE;
+}
+
+// 原地切分 "key = value",去掉换行和两边的空白
+static bool split_config_line(char *line, char **key, char **value) {
+	char *eq = strchr(line, '=');
 
-	for (int i = 0; i < config.exec_once_count; i++) {
-		arg.v = config.exec_once[i];
-		spawn(&arg);
+	if (!eq || eq == line)
+		return false;
+
+	*eq = '\0';
+	*value = eq + 1;
+	(*value)[strcspn(*value, "\n")] = '\0';
+	if (**value == '\0')
+		return false;
+
+	*key = line;
+	trim_whitespace(*key);
+	trim_whitespace(*value);
+	return true;
+}
+
+// parse_func_name 返回堆上的字符串,搬进配置的 arena 随配置一起释放
+static void config_adopt_arg(Config *config, Arg *arg) {
+	char *v = arg->v, *v2 = arg->v2, *v3 = arg->v3;
+
+	arg->v = v ? arena_strdup(&config->arena, v) : NULL;
+	arg->v2 = v2 ? arena_strdup(&config->arena, v2) : NULL;
+	arg->v3 = v3 ? arena_strdup(&config->arena, v3) : NULL;
+	free(v);
+	free(v2);
+	free(v3);
+}
+
+// 客户端会一直引用规则里的动画类型,用静态字符串避免重载后悬空
+static const char *rule_animation_type(const char *val) {
+	static const char *const types[] = {"slide", "zoom", "fade", "none"};
+	size_t i;
+
+	for (i = 0; i < LENGTH(types); i++) {
+		if (strcmp(val, types[i]) == 0)
+			return types[i];
 	}
+	fprintf(stderr, "Error: Unknown animation type: %s\n", val);
+	return NULL;
 }
 
-void parse_config_line(Config *config, const char *line) {
-	char key[256], value[256];
-	if (sscanf(line, "%[^=]=%[^\n]", key, value) != 2) {
+void parse_config_line(Config *config, char *line) {
+	char *key, *value;
+	const ConfigKey *ck;
+	char *field;
+	int id;
+
+	if (!split_config_line(line, &key, &value)) {
 		// fprintf(stderr, "Error: Invalid line format: %s\n", line);
 		return;
 	}
 
-	// Then trim each part separately
-	trim_whitespace(key);
-	trim_whitespace(value);
+	ck = bsearch(key, config_keys, LENGTH(config_keys), sizeof(ConfigKey),
+				 config_key_cmp);
+	if (ck && ck->type != CONFIG_CUSTOM) {
+		field = (char *)config + ck->offset;
+		switch (ck->type) {
+		case CONFIG_INT:
+			*(int *)field = atoi(value);
+			break;
+		case CONFIG_UINT:
+			*(unsigned int *)field = atoi(value);
+			break;
+		case CONFIG_FLOAT:
+			*(float *)field = atof(value);
+			break;
+		case CONFIG_DOUBLE:
+			*(double *)field = atof(value);
+			break;
+		}
+		return;
+	}
+
+	id = ck ? ck->id : config_key_prefix_id(key);
 
-	if (strcmp(key, "animations") == 0) {
-		config->animations = atoi(value);
-	} else if (strcmp(key, "animation_type_open") == 0) {
+	if (id == CFG_KEY_ANIMATION_TYPE_OPEN) {
 		snprintf(config->animation_type_open,
 				 sizeof(config->animation_type_open), "%.9s",
 				 value); // string limit to 9 char
-	} else if (strcmp(key, "animation_type_close") == 0) {
+	} else if (id == CFG_KEY_ANIMATION_TYPE_CLOSE) {
 		snprintf(config->animation_type_close,
 				 sizeof(config->animation_type_close), "%.9s",
 				 value); // string limit to 9 char
-	} else if (strcmp(key, "animation_fade_in") == 0) {
-		config->animation_fade_in = atoi(value);
-	} else if (strcmp(key, "animation_fade_out") == 0) {
-		config->animation_fade_out = atoi(value);
-	} else if (strcmp(key, "tag_animation_direction") == 0) {
-		config->tag_animation_direction = atoi(value);
-	} else if (strcmp(key, "zoom_initial_ratio") == 0) {
-		config->zoom_initial_ratio = atof(value);
-	} else if (strcmp(key, "fadein_begin_opacity") == 0) {
-		config->fadein_begin_opacity = atof(value);
-	} else if (strcmp(key, "fadeout_begin_opacity") == 0) {
-		config->fadeout_begin_opacity = atof(value);
-	} else if (strcmp(key, "animation_duration_move") == 0) {
-		config->animation_duration_move = atoi(value);
-	} else if (strcmp(key, "animation_duration_open") == 0) {
-		config->animation_duration_open = atoi(value);
-	} else if (strcmp(key, "animation_duration_tag") == 0) {
-		config->animation_duration_tag = atoi(value);
-	} else if (strcmp(key, "animation_duration_close") == 0) {
-		config->animation_duration_close = atoi(value);
-	} else if (strcmp(key, "animation_curve_move") == 0) {
+	} else if (id == CFG_KEY_ANIMATION_CURVE_MOVE) {
 		int num = parse_double_array(value, config->animation_curve_move, 4);
 		if (num != 4) {
 			fprintf(stderr, "Error: Failed to parse animation_curve_move: %s\n",
 					value);
 		}
-	} else if (strcmp(key, "animation_curve_open") == 0) {
+	} else if (id == CFG_KEY_ANIMATION_CURVE_OPEN) {
 		int num = parse_double_array(value, config->animation_curve_open, 4);
 		if (num != 4) {
 			fprintf(stderr, "Error: Failed to parse animation_curve_open: %s\n",
 					value);
 		}
-	} else if (strcmp(key, "animation_curve_tag") == 0) {
+	} else if (id == CFG_KEY_ANIMATION_CURVE_TAG) {
 		int num = parse_double_array(value, config->animation_curve_tag, 4);
 		if (num != 4) {
 			fprintf(stderr, "Error: Failed to parse animation_curve_tag: %s\n",
 					value);
 		}
-	} else if (strcmp(key, "animation_curve_close") == 0) {
+	} else if (id == CFG_KEY_ANIMATION_CURVE_CLOSE) {
 		int num = parse_double_array(value, config->animation_curve_close, 4);
 		if (num != 4) {
 			fprintf(stderr,
 					"Error: Failed to parse animation_curve_close: %s\n",
 					value);
 		}
-	} else if (strcmp(key, "scroller_structs") == 0) {
-		config->scroller_structs = atoi(value);
-	} else if (strcmp(key, "scroller_default_proportion") == 0) {
-		config->scroller_default_proportion = atof(value);
-	} else if (strcmp(key, "scroller_default_proportion_single") == 0) {
-		config->scroller_default_proportion_single = atof(value);
-	} else if (strcmp(key, "scroller_focus_center") == 0) {
-		config->scroller_focus_center = atoi(value);
-	} else if (strcmp(key, "scroller_prefer_center") == 0) {
-		config->scroller_prefer_center = atoi(value);
-	} else if (strcmp(key, "focus_cross_monitor") == 0) {
-		config->focus_cross_monitor = atoi(value);
-	} else if (strcmp(key, "focus_cross_tag") == 0) {
-		config->focus_cross_tag = atoi(value);
-	} else if (strcmp(key, "single_scratchpad") == 0) {
-		config->single_scratchpad = atoi(value);
-	} else if (strcmp(key, "xwayland_persistence") == 0) {
-		config->xwayland_persistence = atoi(value);
-	} else if (strcmp(key, "syncobj_enable") == 0) {
-		config->syncobj_enable = atoi(value);
-	} else if (strcmp(key, "no_border_when_single") == 0) {
-		config->no_border_when_single = atoi(value);
-	} else if (strcmp(key, "snap_distance") == 0) {
-		config->snap_distance = atoi(value);
-	} else if (strcmp(key, "enable_floating_snap") == 0) {
-		config->enable_floating_snap = atoi(value);
-	} else if (strcmp(key, "drag_tile_to_tile") == 0) {
-		config->drag_tile_to_tile = atoi(value);
-	} else if (strcmp(key, "swipe_min_threshold") == 0) {
-		config->swipe_min_threshold = atoi(value);
-	} else if (strcmp(key, "xkb_rules_rules") == 0) {
+	} else if (id == CFG_KEY_XKB_RULES_RULES) {
 		strncpy(xkb_rules_rules, value, sizeof(xkb_rules_rules) - 1);
 		xkb_rules_rules[sizeof(xkb_rules_rules) - 1] =
 			'\0'; // 确保字符串以 null 结尾
-	} else if (strcmp(key, "xkb_rules_model") == 0) {
+	} else if (id == CFG_KEY_XKB_RULES_MODEL) {
 		strncpy(xkb_rules_model, value, sizeof(xkb_rules_model) - 1);
 		xkb_rules_model[sizeof(xkb_rules_model) - 1] =
 			'\0'; // 确保字符串以 null 结尾
-	} else if (strcmp(key, "xkb_rules_layout") == 0) {
+	} else if (id == CFG_KEY_XKB_RULES_LAYOUT) {
 		strncpy(xkb_rules_layout, value, sizeof(xkb_rules_layout) - 1);
 		xkb_rules_layout[sizeof(xkb_rules_layout) - 1] =
 			'\0'; // 确保字符串以 null 结尾
-	} else if (strcmp(key, "xkb_rules_variant") == 0) {
+	} else if (id == CFG_KEY_XKB_RULES_VARIANT) {
 		strncpy(xkb_rules_variant, value, sizeof(xkb_rules_variant) - 1);
 		xkb_rules_variant[sizeof(xkb_rules_variant) - 1] =
 			'\0'; // 确保字符串以 null 结尾
-	} else if (strcmp(key, "xkb_rules_options") == 0) {
+	} else if (id == CFG_KEY_XKB_RULES_OPTIONS) {
 		strncpy(xkb_rules_options, value, sizeof(xkb_rules_options) - 1);
 		xkb_rules_options[sizeof(xkb_rules_options) - 1] =
 			'\0'; // 确保字符串以 null 结尾
-	} else if (strcmp(key, "scroller_proportion_preset") == 0) {
+	} else if (id == CFG_KEY_SCROLLER_PROPORTION_PRESET) {
 		// 1. 统计 value 中有多少个逗号，确定需要解析的浮点数个数
 		int count = 0; // 初始化为 0
 		for (const char *p = value; *p; p++) {
@@ -920,7 +1158,7 @@ void parse_config_line(Config *config, const char *line) {
 
 		// 2. 动态分配内存，存储浮点数
 		config->scroller_proportion_preset =
-			(float *)malloc(float_count * sizeof(float));
+			arena_alloc(&config->arena, float_count * sizeof(float));
 		if (!config->scroller_proportion_preset) {
 			fprintf(stderr, "Error: Memory allocation failed\n");
 			return;
@@ -940,8 +1178,8 @@ void parse_config_line(Config *config, const char *line) {
 						"scroller_proportion_preset: %s\n",
 						token);
 				free(value_copy);
-				free(config->scroller_proportion_preset);
 				config->scroller_proportion_preset = NULL;
+				config->scroller_proportion_preset_count = 0;
 				return;
 			}
 
@@ -959,7 +1197,6 @@ void parse_config_line(Config *config, const char *line) {
 					"Error: Invalid scroller_proportion_preset format: %s\n",
 					value);
 			free(value_copy);
-			free(config->scroller_proportion_preset);  // 释放已分配的内存
 			config->scroller_proportion_preset = NULL; // 防止野指针
 			config->scroller_proportion_preset_count = 0;
 			return;
@@ -968,7 +1205,7 @@ void parse_config_line(Config *config, const char *line) {
 
 		// 5. 释放临时复制的字符串
 		free(value_copy);
-	} else if (strcmp(key, "circle_layout") == 0) {
+	} else if (id == CFG_KEY_CIRCLE_LAYOUT) {
 		// 1. 统计 value 中有多少个逗号，确定需要解析的字符串个数
 		int count = 0; // 初始化为 0
 		for (const char *p = value; *p; p++) {
@@ -978,8 +1215,8 @@ void parse_config_line(Config *config, const char *line) {
 		int string_count = count + 1; // 字符串的数量是逗号数量加 1
 
 		// 2. 动态分配内存，存储字符串指针
-		config->circle_layout = (char **)malloc(string_count * sizeof(char *));
-		memset(config->circle_layout, 0, string_count * sizeof(char *));
+		config->circle_layout =
+			arena_alloc(&config->arena, string_count * sizeof(char *));
 		if (!config->circle_layout) {
 			fprintf(stderr, "Error: Memory allocation failed\n");
 			return;
@@ -994,16 +1231,12 @@ void parse_config_line(Config *config, const char *line) {
 		while (token != NULL && i < string_count) {
 			// 为每个字符串分配内存并复制内容
 			cleaned_token = sanitize_string(token);
-			config->circle_layout[i] = strdup(cleaned_token);
+			config->circle_layout[i] =
+				arena_strdup(&config->arena, cleaned_token);
 			if (!config->circle_layout[i]) {
 				fprintf(stderr,
 						"Error: Memory allocation failed for string: %s\n",
 						token);
-				// 释放之前分配的内存
-				for (int j = 0; j < i; j++) {
-					free(config->circle_layout[j]);
-				}
-				free(config->circle_layout);
 				free(value_copy);
 				config->circle_layout = NULL; // 防止野指针
 				config->circle_layout_count = 0;
@@ -1016,11 +1249,6 @@ void parse_config_line(Config *config, const char *line) {
 		// 4. 检查解析的字符串数量是否匹配
 		if (i != string_count) {
 			fprintf(stderr, "Error: Invalid circle_layout format: %s\n", value);
-			// 释放之前分配的内存
-			for (int j = 0; j < i; j++) {
-				free(config->circle_layout[j]);
-			}
-			free(config->circle_layout);
 			free(value_copy);
 			config->circle_layout = NULL; // 防止野指针
 			config->circle_layout_count = 0;
@@ -1030,100 +1258,30 @@ void parse_config_line(Config *config, const char *line) {
 
 		// 5. 释放临时复制的字符串
 		free(value_copy);
-	} else if (strcmp(key, "new_is_master") == 0) {
-		config->new_is_master = atoi(value);
-	} else if (strcmp(key, "default_mfact") == 0) {
-		config->default_mfact = atof(value);
-	} else if (strcmp(key, "default_smfact") == 0) {
-		config->default_smfact = atof(value);
-	} else if (strcmp(key, "default_nmaster") == 0) {
-		config->default_nmaster = atoi(value);
-	} else if (strcmp(key, "hotarea_size") == 0) {
-		config->hotarea_size = atoi(value);
-	} else if (strcmp(key, "enable_hotarea") == 0) {
-		config->enable_hotarea = atoi(value);
-	} else if (strcmp(key, "ov_tab_mode") == 0) {
-		config->ov_tab_mode = atoi(value);
-	} else if (strcmp(key, "overviewgappi") == 0) {
-		config->overviewgappi = atoi(value);
-	} else if (strcmp(key, "overviewgappo") == 0) {
-		config->overviewgappo = atoi(value);
-	} else if (strcmp(key, "cursor_hide_timeout") == 0) {
-		config->cursor_hide_timeout = atoi(value);
-	} else if (strcmp(key, "axis_bind_apply_timeout") == 0) {
-		config->axis_bind_apply_timeout = atoi(value);
-	} else if (strcmp(key, "focus_on_activate") == 0) {
-		config->focus_on_activate = atoi(value);
-	} else if (strcmp(key, "numlockon") == 0) {
-		config->numlockon = atoi(value);
-	} else if (strcmp(key, "bypass_surface_visibility") == 0) {
-		config->bypass_surface_visibility = atoi(value);
-	} else if (strcmp(key, "sloppyfocus") == 0) {
-		config->sloppyfocus = atoi(value);
-	} else if (strcmp(key, "warpcursor") == 0) {
-		config->warpcursor = atoi(value);
-	} else if (strcmp(key, "smartgaps") == 0) {
-		config->smartgaps = atoi(value);
-	} else if (strcmp(key, "repeat_rate") == 0) {
-		config->repeat_rate = atoi(value);
-	} else if (strcmp(key, "repeat_delay") == 0) {
-		config->repeat_delay = atoi(value);
-	} else if (strcmp(key, "tap_to_click") == 0) {
-		config->tap_to_click = atoi(value);
-	} else if (strcmp(key, "tap_and_drag") == 0) {
-		config->tap_and_drag = atoi(value);
-	} else if (strcmp(key, "drag_lock") == 0) {
-		config->drag_lock = atoi(value);
-	} else if (strcmp(key, "mouse_natural_scrolling") == 0) {
-		config->mouse_natural_scrolling = atoi(value);
-	} else if (strcmp(key, "trackpad_natural_scrolling") == 0) {
-		config->trackpad_natural_scrolling = atoi(value);
-	} else if (strcmp(key, "cursor_size") == 0) {
-		config->cursor_size = atoi(value);
-	} else if (strcmp(key, "cursor_theme") == 0) {
-		config->cursor_theme = strdup(value);
-	} else if (strcmp(key, "disable_while_typing") == 0) {
-		config->disable_while_typing = atoi(value);
-	} else if (strcmp(key, "left_handed") == 0) {
-		config->left_handed = atoi(value);
-	} else if (strcmp(key, "middle_button_emulation") == 0) {
-		config->middle_button_emulation = atoi(value);
-	} else if (strcmp(key, "accel_profile") == 0) {
-		config->accel_profile = atoi(value);
-	} else if (strcmp(key, "accel_speed") == 0) {
-		config->accel_speed = atof(value);
-	} else if (strcmp(key, "gappih") == 0) {
-		config->gappih = atoi(value);
-	} else if (strcmp(key, "gappiv") == 0) {
-		config->gappiv = atoi(value);
-	} else if (strcmp(key, "gappoh") == 0) {
-		config->gappoh = atoi(value);
-	} else if (strcmp(key, "gappov") == 0) {
-		config->gappov = atoi(value);
-	} else if (strcmp(key, "borderpx") == 0) {
-		config->borderpx = atoi(value);
-	} else if (strcmp(key, "rootcolor") == 0) {
+	} else if (id == CFG_KEY_CURSOR_THEME) {
+		config->cursor_theme = arena_strdup(&config->arena, value);
+	} else if (id == CFG_KEY_ROOTCOLOR) {
 		long int color = parse_color(value);
 		if (color == -1) {
 			fprintf(stderr, "Error: Invalid rootcolor format: %s\n", value);
 		} else {
 			convert_hex_to_rgba(config->rootcolor, color);
 		}
-	} else if (strcmp(key, "bordercolor") == 0) {
+	} else if (id == CFG_KEY_BORDERCOLOR) {
 		long int color = parse_color(value);
 		if (color == -1) {
 			fprintf(stderr, "Error: Invalid bordercolor format: %s\n", value);
 		} else {
 			convert_hex_to_rgba(config->bordercolor, color);
 		}
-	} else if (strcmp(key, "focuscolor") == 0) {
+	} else if (id == CFG_KEY_FOCUSCOLOR) {
 		long int color = parse_color(value);
 		if (color == -1) {
 			fprintf(stderr, "Error: Invalid focuscolor format: %s\n", value);
 		} else {
 			convert_hex_to_rgba(config->focuscolor, color);
 		}
-	} else if (strcmp(key, "maxmizescreencolor") == 0) {
+	} else if (id == CFG_KEY_MAXMIZESCREENCOLOR) {
 		long int color = parse_color(value);
 		if (color == -1) {
 			fprintf(stderr, "Error: Invalid maxmizescreencolor format: %s\n",
@@ -1131,14 +1289,14 @@ void parse_config_line(Config *config, const char *line) {
 		} else {
 			convert_hex_to_rgba(config->maxmizescreencolor, color);
 		}
-	} else if (strcmp(key, "urgentcolor") == 0) {
+	} else if (id == CFG_KEY_URGENTCOLOR) {
 		long int color = parse_color(value);
 		if (color == -1) {
 			fprintf(stderr, "Error: Invalid urgentcolor format: %s\n", value);
 		} else {
 			convert_hex_to_rgba(config->urgentcolor, color);
 		}
-	} else if (strcmp(key, "scratchpadcolor") == 0) {
+	} else if (id == CFG_KEY_SCRATCHPADCOLOR) {
 		long int color = parse_color(value);
 		if (color == -1) {
 			fprintf(stderr, "Error: Invalid scratchpadcolor format: %s\n",
@@ -1146,21 +1304,21 @@ void parse_config_line(Config *config, const char *line) {
 		} else {
 			convert_hex_to_rgba(config->scratchpadcolor, color);
 		}
-	} else if (strcmp(key, "globalcolor") == 0) {
+	} else if (id == CFG_KEY_GLOBALCOLOR) {
 		long int color = parse_color(value);
 		if (color == -1) {
 			fprintf(stderr, "Error: Invalid globalcolor format: %s\n", value);
 		} else {
 			convert_hex_to_rgba(config->globalcolor, color);
 		}
-	} else if (strcmp(key, "overlaycolor") == 0) {
+	} else if (id == CFG_KEY_OVERLAYCOLOR) {
 		long int color = parse_color(value);
 		if (color == -1) {
 			fprintf(stderr, "Error: Invalid overlaycolor format: %s\n", value);
 		} else {
 			convert_hex_to_rgba(config->overlaycolor, color);
 		}
-	} else if (strcmp(key, "autostart") == 0) {
+	} else if (id == CFG_KEY_AUTOSTART) {
 		if (sscanf(value, "%[^,],%[^,],%[^,]", config->autostart[0],
 				   config->autostart[1], config->autostart[2]) != 3) {
 			fprintf(stderr, "Error: Invalid autostart format: %s\n", value);
@@ -1168,10 +1326,10 @@ void parse_config_line(Config *config, const char *line) {
 		trim_whitespace(config->autostart[0]);
 		trim_whitespace(config->autostart[1]);
 		trim_whitespace(config->autostart[2]);
-	} else if (strcmp(key, "tagrule") == 0) {
+	} else if (id == CFG_KEY_TAGRULE) {
 		config->tag_rules =
-			realloc(config->tag_rules,
-					(config->tag_rules_count + 1) * sizeof(ConfigTagRule));
+			arena_grow(&config->arena, config->tag_rules,
+					   config->tag_rules_count, 1, sizeof(ConfigTagRule));
 		if (!config->tag_rules) {
 			fprintf(stderr, "Error: Failed to allocate memory for tag rules\n");
 			return;
@@ -1198,7 +1356,7 @@ void parse_config_line(Config *config, const char *line) {
 				if (strcmp(key, "id") == 0) {
 					rule->id = CLAMP_INT(atoi(val), 1, LENGTH(tags));
 				} else if (strcmp(key, "layout_name") == 0) {
-					rule->layout_name = strdup(val);
+					rule->layout_name = arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "no_render_border") == 0) {
 					rule->no_render_border = CLAMP_INT(atoi(val), 0, 1);
 				}
@@ -1207,10 +1365,10 @@ void parse_config_line(Config *config, const char *line) {
 		}
 
 		config->tag_rules_count++;
-	} else if (strcmp(key, "windowrule") == 0) {
+	} else if (id == CFG_KEY_WINDOWRULE) {
 		config->window_rules =
-			realloc(config->window_rules,
-					(config->window_rules_count + 1) * sizeof(ConfigWinRule));
+			arena_grow(&config->arena, config->window_rules,
+					   config->window_rules_count, 1, sizeof(ConfigWinRule));
 		if (!config->window_rules) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for window rules\n");
@@ -1262,13 +1420,13 @@ void parse_config_line(Config *config, const char *line) {
 				if (strcmp(key, "isfloating") == 0) {
 					rule->isfloating = atoi(val);
 				} else if (strcmp(key, "title") == 0) {
-					rule->title = strdup(val);
+					rule->title = arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "appid") == 0) {
-					rule->id = strdup(val);
+					rule->id = arena_strdup(&config->arena, val);
 				} else if (strcmp(key, "animation_type_open") == 0) {
-					rule->animation_type_open = strdup(val);
+					rule->animation_type_open = rule_animation_type(val);
 				} else if (strcmp(key, "animation_type_close") == 0) {
-					rule->animation_type_close = strdup(val);
+					rule->animation_type_close = rule_animation_type(val);
 				} else if (strcmp(key, "tags") == 0) {
 					rule->tags = 1 << (atoi(val) - 1);
 				} else if (strcmp(key, "monitor") == 0) {
@@ -1323,10 +1481,10 @@ void parse_config_line(Config *config, const char *line) {
 			token = strtok(NULL, ",");
 		}
 		config->window_rules_count++;
-	} else if (strcmp(key, "monitorrule") == 0) {
-		config->monitor_rules =
-			realloc(config->monitor_rules, (config->monitor_rules_count + 1) *
-											   sizeof(ConfigMonitorRule));
+	} else if (id == CFG_KEY_MONITORRULE) {
+		config->monitor_rules = arena_grow(&config->arena, config->monitor_rules,
+										   config->monitor_rules_count, 1,
+										   sizeof(ConfigMonitorRule));
 		if (!config->monitor_rules) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for monitor rules\n");
@@ -1361,8 +1519,8 @@ void parse_config_line(Config *config, const char *line) {
 			trim_whitespace(raw_y);
 
 			// 转换修剪后的字符串为特定类型
-			rule->name = strdup(raw_name);
-			rule->layout = strdup(raw_layout);
+			rule->name = arena_strdup(&config->arena, raw_name);
+			rule->layout = arena_strdup(&config->arena, raw_layout);
 			rule->mfact = atof(raw_mfact);
 			rule->nmaster = atoi(raw_nmaster);
 			rule->rr = atoi(raw_rr);
@@ -1371,10 +1529,6 @@ void parse_config_line(Config *config, const char *line) {
 			rule->y = atoi(raw_y);
 
 			if (!rule->name || !rule->layout) {
-				if (rule->name)
-					free((void *)rule->name);
-				if (rule->layout)
-					free((void *)rule->layout);
 				fprintf(stderr,
 						"Error: Failed to allocate memory for monitor rule\n");
 				return;
@@ -1384,7 +1538,7 @@ void parse_config_line(Config *config, const char *line) {
 		} else {
 			fprintf(stderr, "Error: Invalid monitorrule format: %s\n", value);
 		}
-	} else if (strncmp(key, "env", 3) == 0) {
+	} else if (id == CFG_KEY_ENV) {
 
 		char env_type[256], env_value[256];
 		if (sscanf(value, "%[^,],%[^\n]", env_type, env_value) < 2) {
@@ -1395,16 +1549,26 @@ void parse_config_line(Config *config, const char *line) {
 		trim_whitespace(env_value);
 		setenv(env_type, env_value, 1);
 
-	} else if (strncmp(key, "exec", 9) == 0) {
-		char **new_exec =
-			realloc(config->exec, (config->exec_count + 1) * sizeof(char *));
+		config->env = arena_grow(&config->arena, config->env,
+								 config->env_count, 1, sizeof(ConfigEnv));
+		if (!config->env)
+			return;
+		config->env[config->env_count].name =
+			arena_strdup(&config->arena, env_type);
+		config->env[config->env_count].value =
+			arena_strdup(&config->arena, env_value);
+		config->env_count++;
+
+	} else if (id == CFG_KEY_EXEC) {
+		char **new_exec = arena_grow(&config->arena, config->exec,
+									 config->exec_count, 1, sizeof(char *));
 		if (!new_exec) {
 			fprintf(stderr, "Error: Failed to allocate memory for exec\n");
 			return;
 		}
 		config->exec = new_exec;
 
-		config->exec[config->exec_count] = strdup(value);
+		config->exec[config->exec_count] = arena_strdup(&config->arena, value);
 		if (!config->exec[config->exec_count]) {
 			fprintf(stderr, "Error: Failed to duplicate exec string\n");
 			return;
@@ -1412,17 +1576,19 @@ void parse_config_line(Config *config, const char *line) {
 
 		config->exec_count++;
 
-	} else if (strncmp(key, "exec-once", 9) == 0) {
+	} else if (id == CFG_KEY_EXEC_ONCE) {
 
-		char **new_exec_once = realloc(
-			config->exec_once, (config->exec_once_count + 1) * sizeof(char *));
+		char **new_exec_once =
+			arena_grow(&config->arena, config->exec_once,
+					   config->exec_once_count, 1, sizeof(char *));
 		if (!new_exec_once) {
 			fprintf(stderr, "Error: Failed to allocate memory for exec_once\n");
 			return;
 		}
 		config->exec_once = new_exec_once;
 
-		config->exec_once[config->exec_once_count] = strdup(value);
+		config->exec_once[config->exec_once_count] =
+			arena_strdup(&config->arena, value);
 		if (!config->exec_once[config->exec_once_count]) {
 			fprintf(stderr, "Error: Failed to duplicate exec_once string\n");
 			return;
@@ -1430,10 +1596,10 @@ void parse_config_line(Config *config, const char *line) {
 
 		config->exec_once_count++;
 
-	} else if (strncmp(key, "bind", 4) == 0) {
+	} else if (id == CFG_KEY_BIND) {
 		config->key_bindings =
-			realloc(config->key_bindings,
-					(config->key_bindings_count + 1) * sizeof(KeyBinding));
+			arena_grow(&config->arena, config->key_bindings,
+					   config->key_bindings_count, 1, sizeof(KeyBinding));
 		if (!config->key_bindings) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for key bindings\n");
@@ -1485,13 +1651,14 @@ void parse_config_line(Config *config, const char *line) {
 			}
 			fprintf(stderr, "Error: Unknown function in bind: %s\n", func_name);
 		} else {
+			config_adopt_arg(config, &binding->arg);
 			config->key_bindings_count++;
 		}
 
-	} else if (strncmp(key, "mousebind", 9) == 0) {
+	} else if (id == CFG_KEY_MOUSEBIND) {
 		config->mouse_bindings =
-			realloc(config->mouse_bindings,
-					(config->mouse_bindings_count + 1) * sizeof(MouseBinding));
+			arena_grow(&config->arena, config->mouse_bindings,
+					   config->mouse_bindings_count, 1, sizeof(MouseBinding));
 		if (!config->mouse_bindings) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for mouse bindings\n");
@@ -1545,12 +1712,13 @@ void parse_config_line(Config *config, const char *line) {
 			fprintf(stderr, "Error: Unknown function in mousebind: %s\n",
 					func_name);
 		} else {
+			config_adopt_arg(config, &binding->arg);
 			config->mouse_bindings_count++;
 		}
-	} else if (strncmp(key, "axisbind", 8) == 0) {
+	} else if (id == CFG_KEY_AXISBIND) {
 		config->axis_bindings =
-			realloc(config->axis_bindings,
-					(config->axis_bindings_count + 1) * sizeof(AxisBinding));
+			arena_grow(&config->arena, config->axis_bindings,
+					   config->axis_bindings_count, 1, sizeof(AxisBinding));
 		if (!config->axis_bindings) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for axis bindings\n");
@@ -1606,13 +1774,15 @@ void parse_config_line(Config *config, const char *line) {
 			fprintf(stderr, "Error: Unknown function in axisbind: %s\n",
 					func_name);
 		} else {
+			config_adopt_arg(config, &binding->arg);
 			config->axis_bindings_count++;
 		}
 
-	} else if (strncmp(key, "gesturebind", 11) == 0) {
-		config->gesture_bindings = realloc(
-			config->gesture_bindings,
-			(config->gesture_bindings_count + 1) * sizeof(GestureBinding));
+	} else if (id == CFG_KEY_GESTUREBIND) {
+		config->gesture_bindings =
+			arena_grow(&config->arena, config->gesture_bindings,
+					   config->gesture_bindings_count, 1,
+					   sizeof(GestureBinding));
 		if (!config->gesture_bindings) {
 			fprintf(stderr,
 					"Error: Failed to allocate memory for axis gesturebind\n");
@@ -1671,24 +1841,53 @@ void parse_config_line(Config *config, const char *line) {
 			fprintf(stderr, "Error: Unknown function in axisbind: %s\n",
 					func_name);
 		} else {
+			config_adopt_arg(config, &binding->arg);
 			config->gesture_bindings_count++;
 		}
 
-	} else if (strncmp(key, "source", 6) == 0) {
+	} else if (id == CFG_KEY_SOURCE) {
 		parse_config_file(config, value);
 	} else {
 		fprintf(stderr, "Error: Unknown key: %s\n", key);
 	}
 }
 
-void parse_config_file(Config *config, const char *file_path) {
+
+static void config_add_source(Config *config, const char *path, FILE *file) {
+	char abs_path[PATH_MAX];
+	ConfigSource *src;
+	struct stat st;
+
+	if (path[0] != '/' && getcwd(abs_path, sizeof(abs_path)) &&
+		strlen(abs_path) + strlen(path) + 2 <= sizeof(abs_path)) {
+		strcat(abs_path, "/");
+		strcat(abs_path, path);
+		path = abs_path;
+	}
+
+	config->sources =
+		arena_grow(&config->arena, config->sources, config->sources_count, 1,
+				   sizeof(ConfigSource));
+	if (!config->sources)
+		return;
+	src = &config->sources[config->sources_count++];
+	src->path = arena_strdup(&config->arena, path);
+	src->size = -1;
+	if (file && fstat(fileno(file), &st) == 0) {
+		src->size = st.st_size;
+		src->mtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+	}
+}
+
+bool parse_config_file(Config *config, const char *file_path) {
 	FILE *file;
+	bool ok;
 	// 检查路径是否以 ~/ 开头
 	if (file_path[0] == '~' && (file_path[1] == '/' || file_path[1] == '\0')) {
 		const char *home = getenv("HOME");
 		if (!home) {
 			fprintf(stderr, "Error: HOME environment variable not set.\n");
-			return;
+			return false;
 		}
 
 		// 构建完整路径（家目录 + / + 原路径去掉 ~）
@@ -1696,15 +1895,17 @@ void parse_config_file(Config *config, const char *file_path) {
 		snprintf(full_path, sizeof(full_path), "%s%s", home, file_path + 1);
 
 		file = fopen(full_path, "r");
+		config_add_source(config, full_path, file);
 		if (!file) {
 			perror("Error opening file");
-			return;
+			return false;
 		}
 	} else {
 		file = fopen(file_path, "r");
+		config_add_source(config, file_path, file);
 		if (!file) {
 			perror("Error opening file");
-			return;
+			return false;
 		}
 	}
 
@@ -1715,23 +1916,11 @@ void parse_config_file(Config *config, const char *file_path) {
 		parse_config_line(config, line);
 	}
 
+	ok = !ferror(file);
+	if (!ok)
+		fprintf(stderr, "Error: Failed to read %s\n", file_path);
 	fclose(file);
-}
-
-void free_circle_layout(Config *config) {
-	if (config->circle_layout) {
-		// 释放每个字符串
-		for (int i = 0; i < config->circle_layout_count; i++) {
-			if (config->circle_layout[i]) {
-				free(config->circle_layout[i]);	 // 释放单个字符串
-				config->circle_layout[i] = NULL; // 防止野指针
-			}
-		}
-		// 释放 circle_layout 数组本身
-		free(config->circle_layout);
-		config->circle_layout = NULL; // 防止野指针
-	}
-	config->circle_layout_count = 0; // 重置计数
+	return ok;
 }
 
 void free_baked_points(void) {
@@ -1753,171 +1942,402 @@ void free_baked_points(void) {
 	}
 }
 
-void free_config(void) {
-	// 释放内存
+static inline uint32_t key_binding_hash(uint32_t mod, uint32_t key) {
+	uint32_t h = key * 0x9e3779b1u ^ mod * 0x85ebca77u;
+	return h ^ (h >> 15);
+}
+
+static inline int key_binding_index_first(const KeyBindingIndex *index,
+										  uint32_t mod, uint32_t key) {
+	if (!index->heads)
+		return -1;
+	return index->heads[key_binding_hash(mod, key) & index->mask];
+}
+
+static bool alloc_key_binding_index(Config *config, KeyBindingIndex *index,
+									uint32_t nbuckets, int count) {
+	uint32_t i;
+
+	index->heads = arena_alloc(&config->arena, nbuckets * sizeof(int));
+	index->next = arena_alloc(&config->arena, count * sizeof(int));
+	if (!index->heads || !index->next) {
+		*index = (KeyBindingIndex){0};
+		return false;
+	}
+	for (i = 0; i < nbuckets; i++)
+		index->heads[i] = -1;
+	index->mask = nbuckets - 1;
+	return true;
+}
+
+void build_key_binding_index(Config *config) {
+	uint32_t nbuckets = 16, h;
+	const KeyBinding *k;
+	KeyBindingIndex *index;
 	int i;
 
-	// 释放 window_rules
-	if (config.window_rules) {
-		for (int i = 0; i < config.window_rules_count; i++) {
-			ConfigWinRule *rule = &config.window_rules[i];
-			free((void *)rule->id);
-			free((void *)rule->title);
-			free((void *)rule->animation_type_open);
-			free((void *)rule->animation_type_close);
-			// 释放 globalkeybinding 的 arg.v（如果动态分配）
-			if (rule->globalkeybinding.arg.v) {
-				free((void *)rule->globalkeybinding.arg.v);
-			}
-		}
-		free(config.window_rules);
-		config.window_rules = NULL;
-		config.window_rules_count = 0;
+	while (nbuckets < (uint32_t)config->key_bindings_count * 2)
+		nbuckets <<= 1;
+
+	if (!alloc_key_binding_index(config, &config->keysym_index, nbuckets,
+								 config->key_bindings_count) ||
+		!alloc_key_binding_index(config, &config->keycode_index, nbuckets,
+								 config->key_bindings_count)) {
+		config->keysym_index = (KeyBindingIndex){0};
+		fprintf(stderr,
+				"Error: Failed to allocate memory for key binding index\n");
+		return;
 	}
 
-	// 释放 monitor_rules
-	if (config.monitor_rules) {
-		for (int i = 0; i < config.monitor_rules_count; i++) {
-			ConfigMonitorRule *rule = &config.monitor_rules[i];
-			free((void *)rule->name);
-			free((void *)rule->layout);
+	// 倒序插入链表头,保证同一个桶内仍按配置顺序触发
+	for (i = config->key_bindings_count - 1; i >= 0; i--) {
+		k = &config->key_bindings[i];
+		if (k->keysymcode.type == KEY_TYPE_CODE) {
+			index = &config->keycode_index;
+			h = key_binding_hash(CLEANMASK(k->mod), k->keysymcode.keycode);
+		} else {
+			index = &config->keysym_index;
+			h = key_binding_hash(CLEANMASK(k->mod),
+								 normalize_keysym(k->keysymcode.keysym));
 		}
-		free(config.monitor_rules);
-		config.monitor_rules = NULL;
-		config.monitor_rules_count = 0;
+		h &= index->mask;
+		index->next[i] = index->heads[h];
+		index->heads[h] = i;
 	}
+}
 
-	// 释放 key_bindings
-	if (config.key_bindings) {
-		for (i = 0; i < config.key_bindings_count; i++) {
-			if (config.key_bindings[i].arg.v) {
-				free((void *)config.key_bindings[i].arg.v);
-				config.key_bindings[i].arg.v = NULL;
-			}
-			if (config.key_bindings[i].arg.v2) {
-				free((void *)config.key_bindings[i].arg.v2);
-				config.key_bindings[i].arg.v2 = NULL;
-			}
-			if (config.key_bindings[i].arg.v3) {
-				free((void *)config.key_bindings[i].arg.v3);
-				config.key_bindings[i].arg.v3 = NULL;
-			}
-		}
-		free(config.key_bindings);
-		config.key_bindings = NULL;
-		config.key_bindings_count = 0;
+void build_globalkey_index(Config *config) {
+	uint32_t nbuckets = 16, h;
+	const KeyBinding *k;
+	KeyBindingIndex *index;
+	int i;
+
+	while (nbuckets < (uint32_t)config->window_rules_count * 2)
+		nbuckets <<= 1;
+
+	if (!alloc_key_binding_index(config, &config->globalkey_keysym_index,
+								 nbuckets, config->window_rules_count) ||
+		!alloc_key_binding_index(config, &config->globalkey_keycode_index,
+								 nbuckets, config->window_rules_count)) {
+		config->globalkey_keysym_index = (KeyBindingIndex){0};
+		fprintf(stderr,
+				"Error: Failed to allocate memory for global key index\n");
+		return;
 	}
 
-	// 释放 mouse_bindings
-	if (config.mouse_bindings) {
-		for (i = 0; i < config.mouse_bindings_count; i++) {
-			if (config.mouse_bindings[i].arg.v) {
-				free((void *)config.mouse_bindings[i].arg.v);
-				config.mouse_bindings[i].arg.v = NULL;
-			}
-			if (config.mouse_bindings[i].arg.v2) {
-				free((void *)config.mouse_bindings[i].arg.v2);
-				config.mouse_bindings[i].arg.v2 = NULL;
-			}
-			if (config.mouse_bindings[i].arg.v3) {
-				free((void *)config.mouse_bindings[i].arg.v3);
-				config.mouse_bindings[i].arg.v3 = NULL;
-			}
+	// 全局按键按原样比较 mod 和 keysym,不做 CLEANMASK 和大小写归一
+	for (i = config->window_rules_count - 1; i >= 0; i--) {
+		k = &config->window_rules[i].globalkeybinding;
+		if (!k->mod || (!k->keysymcode.keysym && !k->keysymcode.keycode))
+			continue;
+		if (k->keysymcode.type == KEY_TYPE_CODE) {
+			index = &config->globalkey_keycode_index;
+			h = key_binding_hash(k->mod, k->keysymcode.keycode);
+		} else {
+			index = &config->globalkey_keysym_index;
+			h = key_binding_hash(k->mod, k->keysymcode.keysym);
 		}
-		free(config.mouse_bindings);
-		config.mouse_bindings = NULL;
-		config.mouse_bindings_count = 0;
+		h &= index->mask;
+		index->next[i] = index->heads[h];
+		index->heads[h] = i;
 	}
+}
 
-	// 释放 axis_bindings
-	if (config.axis_bindings) {
-		for (i = 0; i < config.axis_bindings_count; i++) {
-			if (config.axis_bindings[i].arg.v) {
-				free((void *)config.axis_bindings[i].arg.v);
-				config.axis_bindings[i].arg.v = NULL;
-			}
-			if (config.axis_bindings[i].arg.v2) {
-				free((void *)config.axis_bindings[i].arg.v2);
-				config.axis_bindings[i].arg.v2 = NULL;
-			}
-			if (config.axis_bindings[i].arg.v3) {
-				free((void *)config.axis_bindings[i].arg.v3);
-				config.axis_bindings[i].arg.v3 = NULL;
-			}
-		}
-		free(config.axis_bindings);
-		config.axis_bindings = NULL;
-		config.axis_bindings_count = 0;
+static uint32_t rule_string_hash(const char *str, size_t len) {
+	uint32_t h = 2166136261u;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		h ^= (unsigned char)str[i];
+		h *= 16777619u;
 	}
+	return h;
+}
 
-	// 释放 gesture_bindings
-	if (config.gesture_bindings) {
-		for (i = 0; i < config.gesture_bindings_count; i++) {
-			if (config.gesture_bindings[i].arg.v) {
-				free((void *)config.gesture_bindings[i].arg.v);
-				config.gesture_bindings[i].arg.v = NULL;
-			}
-			if (config.gesture_bindings[i].arg.v2) {
-				free((void *)config.gesture_bindings[i].arg.v2);
-				config.gesture_bindings[i].arg.v2 = NULL;
+static void rule_literal_flush(char *run, size_t *runlen, char *best,
+							   size_t *bestlen) {
+	if (*runlen > *bestlen) {
+		memcpy(best, run, *runlen);
+		*bestlen = *runlen;
+	}
+	*runlen = 0;
+}
+
+/* 从正则里提取一段任何匹配都必然包含的字面量,用于 strstr 预筛.
+ * 提取不出来(顶层有 | 、内联选项等)时返回 NULL,由正则兜底. */
+char *regex_required_literal(const char *pattern, bool *exact) {
+	char run[256], best[256];
+	size_t runlen = 0, bestlen = 0, len;
+	const char *p;
+	int depth = 0;
+	char ch;
+
+	*exact = false;
+	if (!pattern || strstr(pattern, "(?") || strstr(pattern, "\\Q"))
+		return NULL;
+
+	len = strlen(pattern);
+	if (len >= 2 && pattern[0] == '^' && pattern[len - 1] == '$' &&
+		len - 2 < sizeof(best) &&
+		strcspn(pattern + 1, "\\^$.|?*+()[]{}") == len - 2) {
+		*exact = true;
+		return strndup(pattern + 1, len - 2);
+	}
+
+	for (p = pattern; *p; p++) {
+		switch (*p) {
+		case '\\':
+			if (!p[1])
+				return NULL;
+			p++;
+			/* \d \w 之类不是字面量,\x41 \cX \012 \k<name> \p{..} 还带参数,
+			 * 参数不能当成字面量。只按转义分段容易漏掉,直接交给正则 */
+			if (isalnum((unsigned char)*p))
+				return NULL;
+			ch = *p;
+			break;
+		case '(':
+			rule_literal_flush(run, &runlen, best, &bestlen);
+			depth++;
+			continue;
+		case ')':
+			rule_literal_flush(run, &runlen, best, &bestlen);
+			depth--;
+			continue;
+		case '|':
+			if (depth == 0)
+				return NULL;
+			continue;
+		case '[':
+			rule_literal_flush(run, &runlen, best, &bestlen);
+			p++;
+			if (*p == '^')
+				p++;
+			if (*p == ']')
+				p++;
+			while (*p && *p != ']') {
+				if (*p == '\\' && p[1])
+					p++;
+				p++;
 			}
-			if (config.gesture_bindings[i].arg.v3) {
-				free((void *)config.gesture_bindings[i].arg.v3);
-				config.gesture_bindings[i].arg.v3 = NULL;
+			if (!*p)
+				return NULL;
+			continue;
+		case '{':
+		case '?':
+		case '*':
+			// 前一个字符可以不出现,把它(整个 UTF-8 字符)从字面量里去掉
+			while (runlen && ((unsigned char)run[runlen - 1] & 0xc0) == 0x80)
+				runlen--;
+			if (runlen)
+				runlen--;
+			rule_literal_flush(run, &runlen, best, &bestlen);
+			if (*p == '{') {
+				while (*p && *p != '}')
+					p++;
+				if (!*p)
+					return NULL;
 			}
+			continue;
+		case '+':
+		case '.':
+		case '^':
+		case '$':
+			rule_literal_flush(run, &runlen, best, &bestlen);
+			continue;
+		default:
+			ch = *p;
+			break;
 		}
-		free(config.gesture_bindings);
-		config.gesture_bindings = NULL;
-		config.gesture_bindings_count = 0;
-	}
 
-	// 释放 tag_rules
-	if (config.tag_rules) {
-		for (int i = 0; i < config.tag_rules_count; i++) {
-			free((void *)config.tag_rules[i].layout_name);
+		if (depth > 0 || runlen >= sizeof(run)) {
+			rule_literal_flush(run, &runlen, best, &bestlen);
+			continue;
 		}
-		free(config.tag_rules);
-		config.tag_rules = NULL;
-		config.tag_rules_count = 0;
+		run[runlen++] = ch;
 	}
+	rule_literal_flush(run, &runlen, best, &bestlen);
+
+	return bestlen ? strndup(best, bestlen) : NULL;
+}
 
-	// 释放 exec
-	if (config.exec) {
-		for (i = 0; i < config.exec_count; i++) {
-			free(config.exec[i]);
+// 字面量和规则一起放进配置的 arena
+static char *config_literal(Config *config, const char *pattern, bool *exact) {
+	char *lit = regex_required_literal(pattern, exact);
+	char *p = lit ? arena_strdup(&config->arena, lit) : NULL;
+
+	free(lit);
+	return p;
+}
+
+static const char *scratchpad_pattern(const char *arg) {
+	return arg && strncmp(arg, "none", 4) != 0 ? arg : NULL;
+}
+
+void build_window_rule_matcher(Config *config) {
+	uint32_t nbuckets = 16, h;
+	WinRuleFilter *f;
+	bool exact;
+	int i, nslots = config->window_rules_count;
+
+	for (i = 0; i < config->key_bindings_count; i++) {
+		if (config->key_bindings[i].func == toggle_named_scratchpad)
+			nslots++;
+	}
+	if (nslots < 1)
+		return;
+
+	while (nbuckets < (uint32_t)nslots * 2)
+		nbuckets <<= 1;
+
+	config->window_rule_filters =
+		arena_alloc(&config->arena, nslots * sizeof(WinRuleFilter));
+	config->window_rule_scan = arena_alloc(&config->arena, nslots * sizeof(int));
+	if (!config->window_rule_filters || !config->window_rule_scan ||
+		!alloc_key_binding_index(config, &config->window_rule_exact_index,
+								 nbuckets, nslots)) {
+		config->window_rule_filters = NULL;
+		config->window_rule_scan = NULL;
+		config->window_rule_exact_index = (KeyBindingIndex){0};
+		fprintf(stderr,
+				"Error: Failed to allocate memory for window rule matcher\n");
+		return;
+	}
+	config->rule_slots_count = nslots;
+
+	for (i = 0; i < config->window_rules_count; i++) {
+		config->window_rule_filters[i].id = config->window_rules[i].id;
+		config->window_rule_filters[i].title = config->window_rules[i].title;
+	}
+	f = &config->window_rule_filters[config->window_rules_count];
+	for (i = 0; i < config->key_bindings_count; i++) {
+		if (config->key_bindings[i].func != toggle_named_scratchpad)
+			continue;
+		f->arg = &config->key_bindings[i].arg;
+		f->id = scratchpad_pattern(f->arg->v);
+		f->title = scratchpad_pattern(f->arg->v2);
+		f++;
+	}
+
+	for (i = nslots - 1; i >= 0; i--) {
+		f = &config->window_rule_filters[i];
+		f->id_literal = config_literal(config, f->id, &exact);
+		f->id_exact = exact && f->id_literal;
+		f->title_literal = config_literal(config, f->title, &exact);
+
+		if (f->id_exact) {
+			h = rule_string_hash(f->id_literal, strlen(f->id_literal)) &
+				config->window_rule_exact_index.mask;
+			config->window_rule_exact_index.next[i] =
+				config->window_rule_exact_index.heads[h];
+			config->window_rule_exact_index.heads[h] = i;
 		}
-		free(config.exec);
-		config.exec = NULL;
-		config.exec_count = 0;
 	}
 
-	// 释放 exec_once
-	if (config.exec_once) {
-		for (i = 0; i < config.exec_once_count; i++) {
-			free(config.exec_once[i]);
+	for (i = 0; i < nslots; i++) {
+		if (!config->window_rule_filters[i].id_exact)
+			config->window_rule_scan[config->window_rule_scan_count++] = i;
+	}
+}
+
+// named scratchpad 绑定对应的槽位,ipc 临时构造的参数找不到时返回 -1
+int named_scratchpad_slot(const Arg *arg) {
+	int i;
+
+	for (i = config.window_rules_count; i < config.rule_slots_count; i++) {
+		if (config.window_rule_filters[i].arg == arg)
+			return i;
+	}
+	return -1;
+}
+
+static bool window_rule_match_one(int ji, const char *appid,
+								  const char *title) {
+	const WinRuleFilter *f = &config.window_rule_filters[ji];
+
+	if (!f->id && !f->title)
+		return false;
+	if (f->id && (!appid || (f->id_literal && !strstr(appid, f->id_literal)) ||
+				  !regex_match(f->id, appid)))
+		return false;
+	if (f->title &&
+		(!title || (f->title_literal && !strstr(title, f->title_literal)) ||
+		 !regex_match(f->title, title)))
+		return false;
+	return true;
+}
+
+unsigned int window_rules_words(void) {
+	const unsigned int bits = sizeof(unsigned long) * 8;
+	int nslots = config.window_rule_filters ? config.rule_slots_count
+											: config.window_rules_count;
+	return (nslots + bits - 1) / bits;
+}
+
+/* 计算 appid/title 命中的所有规则槽位,bit i 对应 window_rule_filters[i].
+ * 精确 appid 规则直接查表,其余规则先用字面量预筛,最后才跑正则. */
+void window_rules_match(const char *appid, const char *title,
+						unsigned long *bits) {
+	const unsigned int wbits = sizeof(unsigned long) * 8;
+	size_t len;
+	int i, ji;
+
+	memset(bits, 0, window_rules_words() * sizeof(unsigned long));
+
+	if (!config.window_rule_filters) {
+		// 没有预筛表(分配失败),退回逐条匹配
+		for (ji = 0; ji < config.window_rules_count; ji++) {
+			const ConfigWinRule *r = &config.window_rules[ji];
+			if ((r->id || r->title) && (!r->id || regex_match(r->id, appid)) &&
+				(!r->title || regex_match(r->title, title)))
+				bits[ji / wbits] |= 1UL << (ji % wbits);
 		}
-		free(config.exec_once);
-		config.exec_once = NULL;
-		config.exec_once_count = 0;
+		return;
 	}
 
-	// 释放 scroller_proportion_preset
-	if (config.scroller_proportion_preset) {
-		free(config.scroller_proportion_preset);
-		config.scroller_proportion_preset = NULL;
-		config.scroller_proportion_preset_count = 0;
+	if (appid) {
+		// ^literal$ 也匹配末尾多一个换行的字符串
+		len = strlen(appid);
+		if (len && appid[len - 1] == '\n')
+			len--;
+		ji = config.window_rule_exact_index
+				 .heads[rule_string_hash(appid, len) &
+						config.window_rule_exact_index.mask];
+		for (; ji >= 0; ji = config.window_rule_exact_index.next[ji]) {
+			if (strlen(config.window_rule_filters[ji].id_literal) == len &&
+				strncmp(config.window_rule_filters[ji].id_literal, appid,
+						len) == 0 &&
+				window_rule_match_one(ji, appid, title))
+				bits[ji / wbits] |= 1UL << (ji % wbits);
+		}
 	}
 
-	if (config.cursor_theme) {
-		free(config.cursor_theme);
-		config.cursor_theme = NULL;
+	for (i = 0; i < config.window_rule_scan_count; i++) {
+		ji = config.window_rule_scan[i];
+		if (window_rule_match_one(ji, appid, title))
+			bits[ji / wbits] |= 1UL << (ji % wbits);
 	}
+}
+
 
-	// 释放 circle_layout
-	free_circle_layout(&config);
+void free_config(void) {
+	// 配置的动态内存都在 arena 里,一次释放
+	arena_free(&config.arena);
 
-	// 释放动画资源
-	free_baked_points();
+	// 正则缓存属于当前配置,随配置一起释放
+	regex_cache_clear();
+}
+
+// 预先编译规则里的正则,运行时匹配不再编译
+void compile_config_regex(Config *config) {
+	int i;
+
+	for (i = 0; i < config->window_rules_count; i++) {
+		regex_cache_add(config->window_rules[i].id);
+		regex_cache_add(config->window_rules[i].title);
+	}
+	for (i = 0; i < config->monitor_rules_count; i++)
+		regex_cache_add(config->monitor_rules[i].name);
 }
 
 void override_config(void) {
@@ -1973,6 +2393,8 @@ void override_config(void) {
 	// 杂项设置
 	xwayland_persistence = CLAMP_INT(config.xwayland_persistence, 0, 1);
 	syncobj_enable = CLAMP_INT(config.syncobj_enable, 0, 1);
+	config_autoreload = CLAMP_INT(config.config_autoreload, 0, 1);
+	swallow_proc_events = CLAMP_INT(config.swallow_proc_events, 0, 1);
 	axis_bind_apply_timeout =
 		CLAMP_INT(config.axis_bind_apply_timeout, 0, 1000);
 	focus_on_activate = CLAMP_INT(config.focus_on_activate, 0, 1);
@@ -2096,6 +2518,8 @@ void set_value_default() {
 	config.single_scratchpad = single_scratchpad;
 	config.xwayland_persistence = xwayland_persistence;
 	config.syncobj_enable = syncobj_enable;
+	config.config_autoreload = config_autoreload;
+	config.swallow_proc_events = swallow_proc_events;
 	config.no_border_when_single = no_border_when_single;
 	config.snap_distance = snap_distance;
 	config.drag_tile_to_tile = drag_tile_to_tile;
@@ -2158,9 +2582,9 @@ void set_default_key_bindings(Config *config) {
 
 	// 重新分配内存以容纳新的默认按键绑定
 	config->key_bindings =
-		realloc(config->key_bindings,
-				(config->key_bindings_count + default_key_bindings_count) *
-					sizeof(KeyBinding));
+		arena_grow(&config->arena, config->key_bindings,
+				   config->key_bindings_count, default_key_bindings_count,
+				   sizeof(KeyBinding));
 	if (!config->key_bindings) {
 		return;
 	}
@@ -2175,40 +2599,21 @@ void set_default_key_bindings(Config *config) {
 	config->key_bindings_count += default_key_bindings_count;
 }
 
-void parse_config(void) {
+bool parse_config(void) {
 
 	char filename[1024];
-
-	free_config();
-
-	// 重置config结构体，确保所有指针初始化为NULL
+	Config old = config;
+	char xkb[5][256];
+	bool ok;
+
+	// 新一代配置解析到独立的 arena,失败时旧配置原样保留
+	memcpy(xkb[0], xkb_rules_rules, sizeof(xkb[0]));
+	memcpy(xkb[1], xkb_rules_model, sizeof(xkb[1]));
+	memcpy(xkb[2], xkb_rules_layout, sizeof(xkb[2]));
+	memcpy(xkb[3], xkb_rules_variant, sizeof(xkb[3]));
+	memcpy(xkb[4], xkb_rules_options, sizeof(xkb[4]));
 	memset(&config, 0, sizeof(config));
 
-	// 初始化动态数组的指针为NULL，避免野指针
-	config.window_rules = NULL;
-	config.window_rules_count = 0;
-	config.monitor_rules = NULL;
-	config.monitor_rules_count = 0;
-	config.key_bindings = NULL;
-	config.key_bindings_count = 0;
-	config.mouse_bindings = NULL;
-	config.mouse_bindings_count = 0;
-	config.axis_bindings = NULL;
-	config.axis_bindings_count = 0;
-	config.gesture_bindings = NULL;
-	config.gesture_bindings_count = 0;
-	config.exec = NULL;
-	config.exec_count = 0;
-	config.exec_once = NULL;
-	config.exec_once_count = 0;
-	config.scroller_proportion_preset = NULL;
-	config.scroller_proportion_preset_count = 0;
-	config.circle_layout = NULL;
-	config.circle_layout_count = 0;
-	config.tag_rules = NULL;
-	config.tag_rules_count = 0;
-	config.cursor_theme = NULL;
-
 	// 获取 MAOMAOCONFIG 环境变量
 	const char *maomaoconfig = getenv("MAOMAOCONFIG");
 
@@ -2218,7 +2623,8 @@ void parse_config(void) {
 		const char *homedir = getenv("HOME");
 		if (!homedir) {
 			// 如果获取失败，则无法继续
-			return;
+			config = old;
+			return false;
 		}
 		// 构建日志文件路径
 		snprintf(filename, sizeof(filename), "%s/.config/maomao/config.conf",
@@ -2235,72 +2641,226 @@ void parse_config(void) {
 		snprintf(filename, sizeof(filename), "%s/config.conf", maomaoconfig);
 	}
 
-	set_value_default();
-	parse_config_file(&config, filename);
-	set_default_key_bindings(&config);
+	snprintf(config_path, sizeof(config_path), "%s", filename);
+
+	// 启动时优先用编译好的缓存,配置文件没变就不用重新解析
+	if (config_generation == 0 && config_cache_load(filename)) {
+		ok = true;
+	} else {
+		set_value_default();
+		ok = parse_config_file(&config, filename);
+		set_default_key_bindings(&config);
+		build_key_binding_index(&config);
+		build_globalkey_index(&config);
+		build_window_rule_matcher(&config);
+	}
+
+	// 启动时没有旧配置可退回,读不到配置文件也用默认值继续
+	if (config.arena.failed || (!ok && config_generation > 0)) {
+		fprintf(stderr, "Error: Config not applied, keeping the old one\n");
+		arena_free(&config.arena);
+		config = old;
+		memcpy(xkb_rules_rules, xkb[0], sizeof(xkb[0]));
+		memcpy(xkb_rules_model, xkb[1], sizeof(xkb[1]));
+		memcpy(xkb_rules_layout, xkb[2], sizeof(xkb[2]));
+		memcpy(xkb_rules_variant, xkb[3], sizeof(xkb[3]));
+		memcpy(xkb_rules_options, xkb[4], sizeof(xkb[4]));
+		return false;
+	}
+
+	arena_free(&old.arena);
+	regex_cache_clear();
+	compile_config_regex(&config);
 	override_config();
+	config_generation++;
+	return true;
+}
+
+// 重载前记下会被新配置覆盖的状态,重载后只应用真正变化的部分
+typedef struct {
+	char xkb[5][256];
+	double curves[4][4];
+	int nmaster;
+	float mfact;
+	float smfact;
+	unsigned int gaps[4]; // ih, iv, oh, ov
+	unsigned int borderpx;
+	int repeat_rate;
+	int repeat_delay;
+	const Layout *tag_layouts[LENGTH(tags) + 1];
+	/* 影响所有显示器布局的全局设置 */
+	int smartgaps;
+	int scroller_structs;
+	float scroller_default_proportion;
+	float scroller_default_proportion_single;
+	int no_border_when_single;
+	int overviewgappi;
+	int overviewgappo;
+} ConfigSnapshot;
+
+// 标签规则给 tag 指定的布局,多条规则时最后一条生效
+static const Layout *tag_rule_layout(unsigned int tag) {
+	const Layout *lt = NULL;
+	int i, jk;
+
+	for (i = 0; i < config.tag_rules_count; i++) {
+		if (config.tag_rules[i].id != (int)tag)
+			continue;
+		for (jk = 0; jk < LENGTH(layouts); jk++) {
+			if (strcmp(layouts[jk].name, config.tag_rules[i].layout_name) == 0)
+				lt = &layouts[jk];
+		}
+	}
+	return lt;
+}
+
+static void config_snapshot_take(ConfigSnapshot *snap) {
+	unsigned int i;
+
+	memcpy(snap->xkb[0], xkb_rules_rules, sizeof(snap->xkb[0]));
+	memcpy(snap->xkb[1], xkb_rules_model, sizeof(snap->xkb[1]));
+	memcpy(snap->xkb[2], xkb_rules_layout, sizeof(snap->xkb[2]));
+	memcpy(snap->xkb[3], xkb_rules_variant, sizeof(snap->xkb[3]));
+	memcpy(snap->xkb[4], xkb_rules_options, sizeof(snap->xkb[4]));
+	memcpy(snap->curves[0], animation_curve_move, sizeof(snap->curves[0]));
+	memcpy(snap->curves[1], animation_curve_open, sizeof(snap->curves[1]));
+	memcpy(snap->curves[2], animation_curve_tag, sizeof(snap->curves[2]));
+	memcpy(snap->curves[3], animation_curve_close, sizeof(snap->curves[3]));
+	snap->nmaster = default_nmaster;
+	snap->mfact = default_mfact;
+	snap->smfact = default_smfact;
+	snap->gaps[0] = gappih;
+	snap->gaps[1] = gappiv;
+	snap->gaps[2] = gappoh;
+	snap->gaps[3] = gappov;
+	snap->borderpx = borderpx;
+	snap->repeat_rate = repeat_rate;
+	snap->repeat_delay = repeat_delay;
+	for (i = 0; i <= LENGTH(tags); i++)
+		snap->tag_layouts[i] = tag_rule_layout(i);
+	snap->smartgaps = smartgaps;
+	snap->scroller_structs = scroller_structs;
+	snap->scroller_default_proportion = scroller_default_proportion;
+	snap->scroller_default_proportion_single =
+		scroller_default_proportion_single;
+	snap->no_border_when_single = no_border_when_single;
+	snap->overviewgappi = overviewgappi;
+	snap->overviewgappo = overviewgappo;
+}
+
+// 用户手动调整过的值和旧的默认值不同,保留不动
+static bool reload_value_int(int *value, int old_default, int new_default) {
+	if (*value != old_default || old_default == new_default)
+		return false;
+	*value = new_default;
+	return true;
+}
+
+static bool reload_value_uint(unsigned int *value, unsigned int old_default,
+							  unsigned int new_default) {
+	if (*value != old_default || old_default == new_default)
+		return false;
+	*value = new_default;
+	return true;
+}
+
+static bool reload_value_float(float *value, float old_default,
+							   float new_default) {
+	if (*value != old_default || old_default == new_default)
+		return false;
+	*value = new_default;
+	return true;
 }
 
 void reload_config(const Arg *arg) {
 	Client *c;
 	Monitor *m;
-	int i, jk;
+	unsigned int i;
 	Keyboard *kb;
-	parse_config();
-	init_baked_points();
+	ConfigSnapshot old;
+	ConfigSnapshot cur;
+	const Layout *lt;
+	bool relayout_all, dirty;
+
+	config_snapshot_take(&old);
+	if (!parse_config())
+		return;
+	config_snapshot_take(&cur);
+
+	if (memcmp(old.curves, cur.curves, sizeof(old.curves)) != 0)
+		init_baked_points();
 	handlecursoractivity();
-	reset_keyboard_layout();
+	if (memcmp(old.xkb, cur.xkb, sizeof(old.xkb)) != 0)
+		reset_keyboard_layout();
+	config_watch_update();
+	proc_events_update();
 	run_exec();
 
 	// reset border width when config change
-	wl_list_for_each(c, &clients, link) {
-		if (c && !c->iskilling) {
-			if (c->bw && !c->isnoborder) {
-				c->bw = borderpx;
+	if (old.borderpx != cur.borderpx) {
+		wl_list_for_each(c, &clients, link) {
+			if (c && !c->iskilling) {
+				if (c->bw && !c->isnoborder) {
+					c->bw = borderpx;
+				}
 			}
 		}
 	}
 
 	// reset keyboard repeat rate when config change
-	wl_list_for_each(kb, &keyboards, link) {
-		wlr_keyboard_set_repeat_info(kb->wlr_keyboard, repeat_rate,
-									 repeat_delay);
-	}
-
-	// reset master status when config change
-	for (i = 0; i <= LENGTH(tags); i++) {
-		wl_list_for_each(m, &mons, link) {
-			if (!m->wlr_output->enabled) {
-				continue;
-			}
-			m->pertag->nmasters[i] = default_nmaster;
-			m->pertag->mfacts[i] = default_mfact;
-			m->pertag->smfacts[i] = default_smfact;
-			m->gappih = gappih;
-			m->gappiv = gappiv;
-			m->gappoh = gappoh;
-			m->gappov = gappov;
+	if (old.repeat_rate != cur.repeat_rate ||
+		old.repeat_delay != cur.repeat_delay) {
+		wl_list_for_each(kb, &keyboards, link) {
+			wlr_keyboard_set_repeat_info(kb->wlr_keyboard, repeat_rate,
+										 repeat_delay);
 		}
 	}
 
-	// reset tag status by tag rules
+	relayout_all = old.borderpx != cur.borderpx ||
+				   old.smartgaps != cur.smartgaps ||
+				   old.scroller_structs != cur.scroller_structs ||
+				   old.scroller_default_proportion !=
+					   cur.scroller_default_proportion ||
+				   old.scroller_default_proportion_single !=
+					   cur.scroller_default_proportion_single ||
+				   old.no_border_when_single != cur.no_border_when_single ||
+				   old.overviewgappi != cur.overviewgappi ||
+				   old.overviewgappo != cur.overviewgappo;
+
 	wl_list_for_each(m, &mons, link) {
 		if (!m->wlr_output->enabled) {
 			continue;
 		}
-
-		// apply tag rule
-		for (i = 1; i <= config.tag_rules_count; i++) {
-			for (jk = 0; jk < LENGTH(layouts); jk++) {
-				if (config.tag_rules_count > 0 &&
-					strcmp(layouts[jk].name,
-						   config.tag_rules[i - 1].layout_name) == 0) {
-					m->pertag->ltidxs[config.tag_rules[i - 1].id] =
-						&layouts[jk];
-				}
-			}
+		dirty = relayout_all;
+
+		// master status and gaps follow the new defaults unless adjusted
+		for (i = 0; i <= LENGTH(tags); i++) {
+			if ((reload_value_int(&m->pertag->nmasters[i], old.nmaster,
+								  cur.nmaster) |
+				 reload_value_float(&m->pertag->mfacts[i], old.mfact,
+									cur.mfact) |
+				 reload_value_float(&m->pertag->smfacts[i], old.smfact,
+									cur.smfact)) &&
+				i == m->pertag->curtag)
+				dirty = true;
+		}
+		dirty |= reload_value_uint(&m->gappih, old.gaps[0], cur.gaps[0]);
+		dirty |= reload_value_uint(&m->gappiv, old.gaps[1], cur.gaps[1]);
+		dirty |= reload_value_uint(&m->gappoh, old.gaps[2], cur.gaps[2]);
+		dirty |= reload_value_uint(&m->gappov, old.gaps[3], cur.gaps[3]);
+
+		// apply changed tag rules
+		for (i = 1; i <= LENGTH(tags); i++) {
+			lt = cur.tag_layouts[i];
+			if (!lt || lt == old.tag_layouts[i] ||
+				m->pertag->ltidxs[i] == lt)
+				continue;
+			m->pertag->ltidxs[i] = lt;
+			if (i == m->pertag->curtag)
+				dirty = true;
 		}
-	}
 
-	arrange(selmon, false);
+		if (dirty)
+			arrange(m, false);
+	}
 }
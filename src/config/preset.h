@@ -88,6 +88,8 @@ float fullscreen_bg[] = {0.1, 0.1, 0.1, 1.0};
 int warpcursor = 1;			  /* Warp cursor to focused client */
 int xwayland_persistence = 1; /* xwayland persistence */
 int syncobj_enable = 0;
+int config_autoreload = 0; /* reload when the config file changes */
+int swallow_proc_events = 1; /* track terminal processes by events, not /proc */
 
 /* layout(s) */
 Layout overviewlayout = {"󰃇", overview, "overview"};
@@ -0,0 +1,111 @@
+#include <sys/inotify.h>
+
+#define CONFIG_WATCH_DEBOUNCE_MS 300
+
+static int config_watch_fd = -1;
+static int config_watch_wd = -1;
+static struct wl_event_source *config_watch_source;
+static struct wl_event_source *config_watch_timer;
+static char config_watch_dir[1024];
+static char config_watch_name[256];
+
+int config_watch_reload(void *data) {
+	wlr_log(WLR_INFO, "config %s changed, reloading", config_path);
+	reload_config(NULL);
+	return 0;
+}
+
+int config_watch_handle(int fd, uint32_t mask, void *data) {
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	bool changed = false;
+	ssize_t len;
+	char *p;
+
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)p;
+			if ((ev->mask & IN_Q_OVERFLOW) ||
+				(ev->len && strcmp(ev->name, config_watch_name) == 0))
+				changed = true;
+		}
+	}
+
+	// 编辑器保存时会连续写入多次,等文件一段时间不再变化后再重载
+	if (changed)
+		wl_event_source_timer_update(config_watch_timer,
+									 CONFIG_WATCH_DEBOUNCE_MS);
+	return 0;
+}
+
+void config_watch_finish(void) {
+	if (config_watch_timer) {
+		wl_event_source_remove(config_watch_timer);
+		config_watch_timer = NULL;
+	}
+	if (config_watch_source) {
+		wl_event_source_remove(config_watch_source);
+		config_watch_source = NULL;
+	}
+	if (config_watch_fd >= 0) {
+		close(config_watch_fd);
+		config_watch_fd = -1;
+	}
+	config_watch_wd = -1;
+	config_watch_dir[0] = '\0';
+	config_watch_name[0] = '\0';
+}
+
+/* 监听配置文件所在目录而不是文件本身,这样编辑器用 rename 替换文件,
+ * 或者符号链接被换掉时也能收到通知 */
+void config_watch_update(void) {
+	char dir[1024];
+	const char *name, *slash;
+
+	if (!config_autoreload || !event_loop || config_path[0] == '\0') {
+		config_watch_finish();
+		return;
+	}
+
+	slash = strrchr(config_path, '/');
+	if (slash) {
+		snprintf(dir, sizeof(dir), "%.*s", (int)(slash - config_path),
+				 config_path);
+		if (dir[0] == '\0')
+			snprintf(dir, sizeof(dir), "/");
+		name = slash + 1;
+	} else {
+		snprintf(dir, sizeof(dir), ".");
+		name = config_path;
+	}
+
+	if (config_watch_wd >= 0 && strcmp(dir, config_watch_dir) == 0 &&
+		strcmp(name, config_watch_name) == 0)
+		return;
+
+	config_watch_finish();
+
+	config_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (config_watch_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "inotify_init1 failed");
+		return;
+	}
+
+	config_watch_wd = inotify_add_watch(
+		config_watch_fd, dir,
+		IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+	if (config_watch_wd < 0) {
+		wlr_log_errno(WLR_ERROR, "failed to watch %s", dir);
+		config_watch_finish();
+		return;
+	}
+
+	config_watch_source =
+		wl_event_loop_add_fd(event_loop, config_watch_fd, WL_EVENT_READABLE,
+							 config_watch_handle, NULL);
+	config_watch_timer =
+		wl_event_loop_add_timer(event_loop, config_watch_reload, NULL);
+	snprintf(config_watch_dir, sizeof(config_watch_dir), "%s", dir);
+	snprintf(config_watch_name, sizeof(config_watch_name), "%s", name);
+}
@@ -1,5 +1,8 @@
 #include "dwl-ipc-unstable-v2-protocol.h"
 
+/* 从这个版本开始只发送变化的字段 */
+#define DWL_IPC_OUTPUT_DELTA_SINCE_VERSION 3
+
 static void dwl_ipc_manager_bind(struct wl_client *client, void *data,
 								 unsigned int version, unsigned int id);
 static void dwl_ipc_manager_destroy(struct wl_resource *resource);
@@ -30,6 +33,9 @@ static void dwl_ipc_output_dispatch(struct wl_client *client,
 									const char *dispatch, const char *arg1,
 									const char *arg2, const char *arg3,
 									const char *arg4, const char *arg5);
+static void dwl_ipc_output_dispatch_batch(struct wl_client *client,
+										  struct wl_resource *resource,
+										  const char *commands);
 static void dwl_ipc_output_release(struct wl_client *client,
 								   struct wl_resource *resource);
 
@@ -42,6 +48,7 @@ static struct zdwl_ipc_output_v2_interface dwl_output_implementation = {
 	.set_tags = dwl_ipc_output_set_tags,
 	.quit = dwl_ipc_output_quit,
 	.dispatch = dwl_ipc_output_dispatch,
+	.dispatch_batch = dwl_ipc_output_dispatch_batch,
 	.set_layout = dwl_ipc_output_set_layout,
 	.set_client_tags = dwl_ipc_output_set_client_tags};
 
@@ -82,6 +89,7 @@ void dwl_ipc_manager_get_output(struct wl_client *client,
 		return;
 
 	ipc_output = ecalloc(1, sizeof(*ipc_output));
+	ipc_output->tags = ecalloc(LENGTH(tags), sizeof(*ipc_output->tags));
 	ipc_output->resource = output_resource;
 	ipc_output->mon = monitor;
 	wl_resource_set_implementation(output_resource, &dwl_output_implementation,
@@ -98,6 +106,9 @@ void dwl_ipc_manager_release(struct wl_client *client,
 static void dwl_ipc_output_destroy(struct wl_resource *resource) {
 	DwlIpcOutput *ipc_output = wl_resource_get_user_data(resource);
 	wl_list_remove(&ipc_output->link);
+	free(ipc_output->tags);
+	free(ipc_output->title);
+	free(ipc_output->appid);
 	free(ipc_output);
 }
 
@@ -107,75 +118,129 @@ void dwl_ipc_output_printstatus(Monitor *monitor) {
 		dwl_ipc_output_printstatus_to(ipc_output);
 }
 
+// 与上次发送的值比较,需要发送时记录新值并返回 true
+static bool dwl_ipc_changed(bool full, unsigned int *last, unsigned int val) {
+	if (!full && *last == val)
+		return false;
+	*last = val;
+	return true;
+}
+
+static bool dwl_ipc_changed_int(bool full, int *last, int val) {
+	if (!full && *last == val)
+		return false;
+	*last = val;
+	return true;
+}
+
+static bool dwl_ipc_changed_str(bool full, char **last, const char *val) {
+	if (!full && *last && strcmp(*last, val) == 0)
+		return false;
+	free(*last);
+	*last = strdup(val);
+	return true;
+}
+
 void dwl_ipc_output_printstatus_to(DwlIpcOutput *ipc_output) {
 	Monitor *monitor = ipc_output->mon;
-	Client *c, *focused;
+	struct wl_resource *resource = ipc_output->resource;
+	unsigned int version = wl_resource_get_version(resource);
+	Client *focused;
+	DwlIpcTag *last;
 	int tagmask, state, numclients, focused_client, tag;
 	const char *title, *appid, *symbol;
+	bool full, changed = false;
+
+	/* v3 以前的客户端每次都收到完整状态 */
+	full = !ipc_output->sent || version < DWL_IPC_OUTPUT_DELTA_SINCE_VERSION;
 	focused = focustop(monitor);
-	zdwl_ipc_output_v2_send_active(ipc_output->resource, monitor == selmon);
+	if (dwl_ipc_changed(full, &ipc_output->active, monitor == selmon)) {
+		zdwl_ipc_output_v2_send_active(resource, ipc_output->active);
+		changed = true;
+	}
 
 	for (tag = 0; tag < LENGTH(tags); tag++) {
-		numclients = state = focused_client = 0;
+		state = 0;
 		tagmask = 1 << tag;
 		if ((tagmask & monitor->tagset[monitor->seltags]) != 0)
 			state |= ZDWL_IPC_OUTPUT_V2_TAG_STATE_ACTIVE;
-		wl_list_for_each(c, &clients, link) {
-			if (c->mon != monitor)
-				continue;
-			if (!(c->tags & tagmask))
-				continue;
-			if (c == focused)
-				focused_client = 1;
-			if (c->isurgent)
-				state |= ZDWL_IPC_OUTPUT_V2_TAG_STATE_URGENT;
-			numclients++;
-		}
-		zdwl_ipc_output_v2_send_tag(ipc_output->resource, tag, state,
-									numclients, focused_client);
+		if (monitor->pertag->nurgent[tag])
+			state |= ZDWL_IPC_OUTPUT_V2_TAG_STATE_URGENT;
+		numclients = monitor->pertag->nclients[tag];
+		focused_client = focused && (focused->tags & tagmask);
+		last = &ipc_output->tags[tag];
+		if (!full && last->state == state && last->clients == numclients &&
+			last->focused == focused_client)
+			continue;
+		last->state = state;
+		last->clients = numclients;
+		last->focused = focused_client;
+		zdwl_ipc_output_v2_send_tag(resource, tag, state, numclients,
+									focused_client);
+		changed = true;
 	}
 
 	title = focused ? client_get_title(focused) : "";
 	appid = focused ? client_get_appid(focused) : "";
+	title = title ? title : broken;
+	appid = appid ? appid : broken;
 	symbol = monitor->pertag->ltidxs[monitor->pertag->curtag]->symbol;
 
-	zdwl_ipc_output_v2_send_layout(
-		ipc_output->resource,
-		monitor->pertag->ltidxs[monitor->pertag->curtag] - layouts);
-	zdwl_ipc_output_v2_send_title(ipc_output->resource, title ? title : broken);
-	zdwl_ipc_output_v2_send_appid(ipc_output->resource, appid ? appid : broken);
-	zdwl_ipc_output_v2_send_layout_symbol(ipc_output->resource, symbol);
-	if (wl_resource_get_version(ipc_output->resource) >=
-		ZDWL_IPC_OUTPUT_V2_FULLSCREEN_SINCE_VERSION) {
-		zdwl_ipc_output_v2_send_fullscreen(ipc_output->resource,
-										   focused ? focused->isfullscreen : 0);
+	if (dwl_ipc_changed(full, &ipc_output->layout,
+						monitor->pertag->ltidxs[monitor->pertag->curtag] -
+							layouts)) {
+		zdwl_ipc_output_v2_send_layout(resource, ipc_output->layout);
+		changed = true;
 	}
-	if (wl_resource_get_version(ipc_output->resource) >=
-		ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION) {
-		zdwl_ipc_output_v2_send_floating(ipc_output->resource,
-										 focused ? focused->isfloating : 0);
+	if (dwl_ipc_changed_str(full, &ipc_output->title, title)) {
+		zdwl_ipc_output_v2_send_title(resource, title);
+		changed = true;
 	}
-	if (wl_resource_get_version(ipc_output->resource) >=
-		ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION) {
-		zdwl_ipc_output_v2_send_x(ipc_output->resource,
-								  focused ? focused->geom.x : 0);
+	if (dwl_ipc_changed_str(full, &ipc_output->appid, appid)) {
+		zdwl_ipc_output_v2_send_appid(resource, appid);
+		changed = true;
 	}
-	if (wl_resource_get_version(ipc_output->resource) >=
-		ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION) {
-		zdwl_ipc_output_v2_send_y(ipc_output->resource,
-								  focused ? focused->geom.y : 0);
+	if (full || ipc_output->symbol != symbol) {
+		ipc_output->symbol = symbol;
+		zdwl_ipc_output_v2_send_layout_symbol(resource, symbol);
+		changed = true;
 	}
-	if (wl_resource_get_version(ipc_output->resource) >=
-		ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION) {
-		zdwl_ipc_output_v2_send_width(ipc_output->resource,
-									  focused ? focused->geom.width : 0);
+	if (version >= ZDWL_IPC_OUTPUT_V2_FULLSCREEN_SINCE_VERSION &&
+		dwl_ipc_changed(full, &ipc_output->fullscreen,
+						focused ? focused->isfullscreen : 0)) {
+		zdwl_ipc_output_v2_send_fullscreen(resource, ipc_output->fullscreen);
+		changed = true;
 	}
-	if (wl_resource_get_version(ipc_output->resource) >=
-		ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION) {
-		zdwl_ipc_output_v2_send_height(ipc_output->resource,
-									   focused ? focused->geom.height : 0);
+	if (version >= ZDWL_IPC_OUTPUT_V2_FLOATING_SINCE_VERSION) {
+		if (dwl_ipc_changed(full, &ipc_output->floating,
+							focused ? focused->isfloating : 0)) {
+			zdwl_ipc_output_v2_send_floating(resource, ipc_output->floating);
+			changed = true;
+		}
+		if (dwl_ipc_changed_int(full, &ipc_output->x,
+								focused ? focused->geom.x : 0)) {
+			zdwl_ipc_output_v2_send_x(resource, ipc_output->x);
+			changed = true;
+		}
+		if (dwl_ipc_changed_int(full, &ipc_output->y,
+								focused ? focused->geom.y : 0)) {
+			zdwl_ipc_output_v2_send_y(resource, ipc_output->y);
+			changed = true;
+		}
+		if (dwl_ipc_changed_int(full, &ipc_output->width,
+								focused ? focused->geom.width : 0)) {
+			zdwl_ipc_output_v2_send_width(resource, ipc_output->width);
+			changed = true;
+		}
+		if (dwl_ipc_changed_int(full, &ipc_output->height,
+								focused ? focused->geom.height : 0)) {
+			zdwl_ipc_output_v2_send_height(resource, ipc_output->height);
+			changed = true;
+		}
 	}
-	zdwl_ipc_output_v2_send_frame(ipc_output->resource);
+	ipc_output->sent = true;
+	if (changed)
+		zdwl_ipc_output_v2_send_frame(resource);
 }
 
 void dwl_ipc_output_set_client_tags(struct wl_client *client,
@@ -201,6 +266,7 @@ void dwl_ipc_output_set_client_tags(struct wl_client *client,
 		return;
 
 	selected_client->tags = newtags;
+	client_update_tagcount(selected_client);
 	if (selmon == monitor)
 		focusclient(focustop(monitor), 1);
 	arrange(selmon, false);
@@ -261,6 +327,18 @@ void dwl_ipc_output_dispatch(struct wl_client *client,
 	}
 }
 
+void dwl_ipc_output_dispatch_batch(struct wl_client *client,
+								   struct wl_resource *resource,
+								   const char *commands) {
+	char *cmds = strdup(commands);
+	int count;
+
+	if (!cmds)
+		return;
+	run_dispatch_batch(cmds, &count);
+	free(cmds);
+}
+
 void dwl_ipc_output_release(struct wl_client *client,
 							struct wl_resource *resource) {
 	wl_resource_destroy(resource);
@@ -0,0 +1,565 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* 脚本用的 unix socket IPC,每行一个请求,每行一个 JSON 回复或事件:
+ *   get_clients
+ *   get_monitors
+ *   get_stats                        对象池的用量
+ *   dispatch <func>[ <arg1>,<arg2>,...]
+ *   batch <func>[ <args>]; <func>[ <args>]; ...
+ *       引号里的 ';' 和 "\;" 不分隔命令;有一条解析不了整批都不执行
+ *   subscribe <event> [<event>...]   focus title tag layout window
+ */
+
+#define IPC_LINE_MAX 4096
+#define IPC_OUT_MAX (1 << 20) /* 超过这个大小还没读走的客户端会被断开 */
+
+enum {
+	IPC_EVENT_FOCUS = 1 << 0,
+	IPC_EVENT_TITLE = 1 << 1,
+	IPC_EVENT_TAG = 1 << 2,
+	IPC_EVENT_LAYOUT = 1 << 3,
+	IPC_EVENT_WINDOW = 1 << 4,
+};
+
+static const char *const ipc_event_names[] = {"focus", "title", "tag",
+											  "layout", "window"};
+
+typedef struct {
+	char *data;
+	size_t len, cap;
+} IpcBuf;
+
+typedef struct {
+	struct wl_list link;
+	int fd;
+	struct wl_event_source *source;
+	unsigned int events;
+	bool dead;
+	char in[IPC_LINE_MAX];
+	size_t in_len;
+	IpcBuf out;
+} IpcClient;
+
+static int ipc_fd = -1;
+static struct wl_event_source *ipc_source;
+static struct wl_list ipc_clients;
+static char ipc_path[108];
+static unsigned int ipc_events;			 /* 所有客户端订阅的事件 */
+static unsigned int ipc_client_serial; /* 分配给窗口的 id */
+static unsigned int ipc_focus_id;
+static IpcClient *ipc_handling;
+
+static bool ipc_buf_reserve(IpcBuf *b, size_t add) {
+	size_t cap = b->cap ? b->cap : 256;
+	char *data;
+
+	if (b->len + add <= b->cap)
+		return true;
+	while (cap < b->len + add)
+		cap *= 2;
+	data = realloc(b->data, cap);
+	if (!data)
+		return false;
+	b->data = data;
+	b->cap = cap;
+	return true;
+}
+
+static void ipc_buf_append(IpcBuf *b, const char *s, size_t len) {
+	if (!ipc_buf_reserve(b, len))
+		return;
+	memcpy(b->data + b->len, s, len);
+	b->len += len;
+}
+
+static void ipc_buf_printf(IpcBuf *b, const char *fmt, ...) {
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	if (n < 0 || !ipc_buf_reserve(b, n + 1))
+		return;
+	va_start(ap, fmt);
+	vsnprintf(b->data + b->len, n + 1, fmt, ap);
+	va_end(ap);
+	b->len += n;
+}
+
+static void ipc_buf_string(IpcBuf *b, const char *s) {
+	const unsigned char *p;
+
+	if (!s) {
+		ipc_buf_append(b, "null", 4);
+		return;
+	}
+	ipc_buf_append(b, "\"", 1);
+	for (p = (const unsigned char *)s; *p; p++) {
+		if (*p == '"' || *p == '\\') {
+			ipc_buf_append(b, "\\", 1);
+			ipc_buf_append(b, (const char *)p, 1);
+		} else if (*p < 0x20) {
+			ipc_buf_printf(b, "\\u%04x", *p);
+		} else {
+			ipc_buf_append(b, (const char *)p, 1);
+		}
+	}
+	ipc_buf_append(b, "\"", 1);
+}
+
+static unsigned int ipc_client_id(Client *c) {
+	if (!c->ipc_id)
+		c->ipc_id = ++ipc_client_serial;
+	return c->ipc_id;
+}
+
+static void ipc_json_client(IpcBuf *b, Client *c) {
+	Client *focused = selmon ? selmon->sel : NULL;
+
+	ipc_buf_printf(b, "{\"id\":%u,\"title\":", ipc_client_id(c));
+	ipc_buf_string(b, client_get_title(c));
+	ipc_buf_append(b, ",\"appid\":", 9);
+	ipc_buf_string(b, client_get_appid(c));
+	ipc_buf_append(b, ",\"monitor\":", 11);
+	ipc_buf_string(b, c->mon ? c->mon->wlr_output->name : NULL);
+	ipc_buf_printf(b,
+				   ",\"tags\":%u,\"focused\":%s,\"floating\":%s,"
+				   "\"fullscreen\":%s,\"minimized\":%s,\"urgent\":%s,"
+				   "\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d}",
+				   c->tags, c == focused ? "true" : "false",
+				   c->isfloating ? "true" : "false",
+				   c->isfullscreen ? "true" : "false",
+				   c->isminied ? "true" : "false",
+				   c->isurgent ? "true" : "false", c->geom.x, c->geom.y,
+				   c->geom.width, c->geom.height);
+}
+
+// 有窗口的 tag 和有紧急窗口的 tag,直接取 pertag 计数
+static void ipc_monitor_tags(Monitor *m, unsigned int *occupied,
+							 unsigned int *urgent) {
+	unsigned int i;
+
+	*occupied = *urgent = 0;
+	for (i = 0; i < LENGTH(tags); i++) {
+		if (m->pertag->nclients[i])
+			*occupied |= 1 << i;
+		if (m->pertag->nurgent[i])
+			*urgent |= 1 << i;
+	}
+}
+
+static void ipc_json_monitor(IpcBuf *b, Monitor *m) {
+	unsigned int occupied, urgent;
+
+	ipc_monitor_tags(m, &occupied, &urgent);
+	ipc_buf_append(b, "{\"name\":", 8);
+	ipc_buf_string(b, m->wlr_output->name);
+	ipc_buf_printf(b, ",\"focused\":%s,\"enabled\":%s,\"layout\":",
+				   m == selmon ? "true" : "false",
+				   m->wlr_output->enabled ? "true" : "false");
+	ipc_buf_string(b, m->pertag->ltidxs[m->pertag->curtag]->symbol);
+	ipc_buf_printf(b,
+				   ",\"tags\":%u,\"occupied\":%u,\"urgent\":%u,"
+				   "\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d}",
+				   m->tagset[m->seltags], occupied, urgent, m->m.x, m->m.y,
+				   m->m.width, m->m.height);
+}
+
+void ipc_client_destroy(IpcClient *ic) {
+	IpcClient *other;
+
+	// 正在处理这个客户端的请求时只做标记,回到 ipc_client_handle 再释放
+	if (ic == ipc_handling) {
+		ic->dead = true;
+		return;
+	}
+	wl_list_remove(&ic->link);
+	wl_event_source_remove(ic->source);
+	close(ic->fd);
+	free(ic->out.data);
+	free(ic);
+
+	ipc_events = 0;
+	wl_list_for_each(other, &ipc_clients, link)
+		ipc_events |= other->events;
+}
+
+static void ipc_client_flush(IpcClient *ic) {
+	ssize_t n;
+
+	while (ic->out.len > 0) {
+		n = send(ic->fd, ic->out.data, ic->out.len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (n < 0) {
+			ipc_client_destroy(ic);
+			return;
+		}
+		ic->out.len -= n;
+		memmove(ic->out.data, ic->out.data + n, ic->out.len);
+	}
+
+	// 只有写不完的时候才关心可写事件
+	wl_event_source_fd_update(ic->source,
+							  ic->out.len ? WL_EVENT_READABLE |
+												WL_EVENT_WRITABLE
+										  : WL_EVENT_READABLE);
+}
+
+static void ipc_client_send(IpcClient *ic, const char *data, size_t len) {
+	if (ic->dead)
+		return;
+	if (ic->out.len + len > IPC_OUT_MAX) {
+		wlr_log(WLR_ERROR, "ipc client %d is not reading, disconnecting",
+				ic->fd);
+		ipc_client_destroy(ic);
+		return;
+	}
+	ipc_buf_append(&ic->out, data, len);
+	ipc_client_flush(ic);
+}
+
+static void ipc_client_reply(IpcClient *ic, IpcBuf *b) {
+	ipc_buf_append(b, "\n", 1);
+	ipc_client_send(ic, b->data, b->len);
+	free(b->data);
+}
+
+static void ipc_client_error(IpcClient *ic, const char *error) {
+	IpcBuf b = {0};
+
+	ipc_buf_append(&b, "{\"success\":false,\"error\":", 25);
+	ipc_buf_string(&b, error);
+	ipc_buf_append(&b, "}", 1);
+	ipc_client_reply(ic, &b);
+}
+
+static void ipc_get_clients(IpcClient *ic) {
+	IpcBuf b = {0};
+	Client *c;
+	bool first = true;
+
+	ipc_buf_printf(&b, "{\"success\":true,\"clients\":[");
+	wl_list_for_each(c, &clients, link) {
+		if (!first)
+			ipc_buf_append(&b, ",", 1);
+		ipc_json_client(&b, c);
+		first = false;
+	}
+	ipc_buf_append(&b, "]}", 2);
+	ipc_client_reply(ic, &b);
+}
+
+static void ipc_get_monitors(IpcClient *ic) {
+	IpcBuf b = {0};
+	Monitor *m;
+	bool first = true;
+
+	ipc_buf_printf(&b, "{\"success\":true,\"monitors\":[");
+	wl_list_for_each(m, &mons, link) {
+		if (!first)
+			ipc_buf_append(&b, ",", 1);
+		ipc_json_monitor(&b, m);
+		first = false;
+	}
+	ipc_buf_append(&b, "]}", 2);
+	ipc_client_reply(ic, &b);
+}
+
+static void ipc_get_stats(IpcClient *ic) {
+	IpcBuf b = {0};
+	size_t i;
+
+	ipc_buf_printf(&b, "{\"success\":true,\"pools\":[");
+	for (i = 0; i < LENGTH(pools); i++) {
+		ipc_buf_printf(&b,
+					   "%s{\"name\":\"%s\",\"object_size\":%zu,"
+					   "\"used\":%zu,\"high_water\":%zu,\"capacity\":%zu,"
+					   "\"slabs\":%zu,\"allocs\":%lu}",
+					   i ? "," : "", pools[i]->name, pools[i]->size,
+					   pools[i]->used, pools[i]->high_water,
+					   pool_capacity(pools[i]), pools[i]->slab_count,
+					   pools[i]->allocs);
+	}
+	ipc_buf_append(&b, "]}", 2);
+	ipc_client_reply(ic, &b);
+}
+
+static void ipc_dispatch(IpcClient *ic, char *line) {
+	IpcBuf b = {0};
+
+	if (!run_dispatch(line)) {
+		ipc_client_error(ic, "unknown dispatch");
+		return;
+	}
+	ipc_buf_printf(&b, "{\"success\":true}");
+	ipc_client_reply(ic, &b);
+}
+
+static void ipc_batch(IpcClient *ic, char *line) {
+	IpcBuf b = {0};
+	int count, failed;
+
+	failed = run_dispatch_batch(line, &count);
+	ipc_buf_printf(&b, "{\"success\":%s,\"count\":%d,\"failed\":%d}",
+				   failed ? "false" : "true", count, failed);
+	ipc_client_reply(ic, &b);
+}
+
+static void ipc_subscribe(IpcClient *ic, char *line) {
+	unsigned int events = 0, i;
+	char *name, *save = NULL;
+	IpcBuf b = {0};
+
+	for (name = strtok_r(line, ", \t", &save); name;
+		 name = strtok_r(NULL, ", \t", &save)) {
+		for (i = 0; i < LENGTH(ipc_event_names); i++) {
+			if (strcmp(name, ipc_event_names[i]) == 0)
+				break;
+		}
+		if (i == LENGTH(ipc_event_names)) {
+			ipc_client_error(ic, "unknown event");
+			return;
+		}
+		events |= 1 << i;
+	}
+
+	ic->events |= events;
+	ipc_events |= events;
+	ipc_buf_printf(&b, "{\"success\":true}");
+	ipc_client_reply(ic, &b);
+}
+
+static void ipc_client_request(IpcClient *ic, char *line) {
+	char *rest;
+
+	trim_whitespace(line);
+	if (line[0] == '\0')
+		return;
+	rest = line + strcspn(line, " \t");
+	if (*rest)
+		*rest++ = '\0';
+
+	if (strcmp(line, "get_clients") == 0)
+		ipc_get_clients(ic);
+	else if (strcmp(line, "get_monitors") == 0)
+		ipc_get_monitors(ic);
+	else if (strcmp(line, "get_stats") == 0)
+		ipc_get_stats(ic);
+	else if (strcmp(line, "dispatch") == 0)
+		ipc_dispatch(ic, rest);
+	else if (strcmp(line, "batch") == 0)
+		ipc_batch(ic, rest);
+	else if (strcmp(line, "subscribe") == 0)
+		ipc_subscribe(ic, rest);
+	else
+		ipc_client_error(ic, "unknown request");
+}
+
+static void ipc_client_read(IpcClient *ic) {
+	char *line, *nl;
+	size_t used;
+	ssize_t n;
+
+	while (!ic->dead) {
+		n = read(ic->fd, ic->in + ic->in_len, sizeof(ic->in) - ic->in_len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return;
+		if (n <= 0) {
+			ipc_client_destroy(ic);
+			return;
+		}
+		ic->in_len += n;
+
+		line = ic->in;
+		while (!ic->dead &&
+			   (nl = memchr(line, '\n', ic->in + ic->in_len - line))) {
+			*nl = '\0';
+			ipc_client_request(ic, line);
+			line = nl + 1;
+		}
+		used = line - ic->in;
+		memmove(ic->in, line, ic->in_len - used);
+		ic->in_len -= used;
+		if (ic->in_len == sizeof(ic->in)) {
+			ipc_client_error(ic, "request too long");
+			ipc_client_destroy(ic);
+		}
+	}
+}
+
+int ipc_client_handle(int fd, uint32_t mask, void *data) {
+	IpcClient *ic = data;
+
+	ipc_handling = ic;
+	if (mask & WL_EVENT_WRITABLE)
+		ipc_client_flush(ic);
+	if (!ic->dead && (mask & WL_EVENT_READABLE))
+		ipc_client_read(ic);
+	if (!ic->dead && (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR)))
+		ic->dead = true;
+	ipc_handling = NULL;
+
+	if (ic->dead)
+		ipc_client_destroy(ic);
+	return 0;
+}
+
+int ipc_socket_accept(int fd, uint32_t mask, void *data) {
+	IpcClient *ic;
+	int cfd;
+
+	while ((cfd = accept(fd, NULL, NULL)) >= 0) {
+		fcntl(cfd, F_SETFD, FD_CLOEXEC);
+		fcntl(cfd, F_SETFL, fcntl(cfd, F_GETFL) | O_NONBLOCK);
+		ic = ecalloc(1, sizeof(*ic));
+		ic->fd = cfd;
+		ic->source = wl_event_loop_add_fd(event_loop, cfd, WL_EVENT_READABLE,
+										  ipc_client_handle, ic);
+		if (!ic->source) {
+			close(cfd);
+			free(ic);
+			continue;
+		}
+		wl_list_insert(&ipc_clients, &ic->link);
+	}
+	return 0;
+}
+
+// 把事件发给订阅了它的客户端,json 不含结尾的换行
+static void ipc_broadcast(unsigned int event, IpcBuf *b) {
+	IpcClient *ic, *tmp;
+
+	ipc_buf_append(b, "\n", 1);
+	wl_list_for_each_safe(ic, tmp, &ipc_clients, link) {
+		if (ic->events & event)
+			ipc_client_send(ic, b->data, b->len);
+	}
+	free(b->data);
+}
+
+void ipc_event_client(unsigned int event, Client *c, const char *change) {
+	IpcBuf b = {0};
+
+	if (!(ipc_events & event))
+		return;
+	ipc_buf_printf(&b, "{\"event\":\"%s\",",
+				   ipc_event_names[__builtin_ctz(event)]);
+	if (change)
+		ipc_buf_printf(&b, "\"change\":\"%s\",", change);
+	ipc_buf_append(&b, "\"client\":", 9);
+	if (c)
+		ipc_json_client(&b, c);
+	else
+		ipc_buf_append(&b, "null", 4);
+	ipc_buf_append(&b, "}", 1);
+	ipc_broadcast(event, &b);
+}
+
+static void ipc_event_monitor(unsigned int event, Monitor *m) {
+	IpcBuf b = {0};
+
+	ipc_buf_printf(&b, "{\"event\":\"%s\",\"monitor\":",
+				   ipc_event_names[__builtin_ctz(event)]);
+	ipc_json_monitor(&b, m);
+	ipc_buf_append(&b, "}", 1);
+	ipc_broadcast(event, &b);
+}
+
+/* 在 printstatus 的 idle 里调用,和上次的状态比较,
+ * 多次变化合并成一个事件 */
+void ipc_socket_status(Monitor *m) {
+	unsigned int occupied, urgent;
+	const Layout *layout;
+
+	if (!(ipc_events & (IPC_EVENT_TAG | IPC_EVENT_LAYOUT)))
+		return;
+
+	ipc_monitor_tags(m, &occupied, &urgent);
+	if (m->ipc_tagset != m->tagset[m->seltags] ||
+		m->ipc_occupied != occupied || m->ipc_urgent != urgent) {
+		m->ipc_tagset = m->tagset[m->seltags];
+		m->ipc_occupied = occupied;
+		m->ipc_urgent = urgent;
+		if (ipc_events & IPC_EVENT_TAG)
+			ipc_event_monitor(IPC_EVENT_TAG, m);
+	}
+
+	layout = m->pertag->ltidxs[m->pertag->curtag];
+	if (m->ipc_layout != layout) {
+		m->ipc_layout = layout;
+		if (ipc_events & IPC_EVENT_LAYOUT)
+			ipc_event_monitor(IPC_EVENT_LAYOUT, m);
+	}
+}
+
+void ipc_socket_focus(void) {
+	Client *c = selmon ? selmon->sel : NULL;
+	unsigned int id = c ? ipc_client_id(c) : 0;
+
+	if (id == ipc_focus_id)
+		return;
+	ipc_focus_id = id;
+	ipc_event_client(IPC_EVENT_FOCUS, c, NULL);
+}
+
+void ipc_socket_init(const char *display) {
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	const char *dir = getenv("XDG_RUNTIME_DIR");
+
+	wl_list_init(&ipc_clients);
+	if (!dir || !display)
+		return;
+	if (snprintf(ipc_path, sizeof(ipc_path), "%s/maomao-%s.sock", dir,
+				 display) >= (int)sizeof(ipc_path)) {
+		wlr_log(WLR_ERROR, "ipc socket path too long");
+		ipc_path[0] = '\0';
+		return;
+	}
+
+	ipc_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (ipc_fd < 0) {
+		wlr_log_errno(WLR_ERROR, "ipc socket failed");
+		ipc_path[0] = '\0';
+		return;
+	}
+
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", ipc_path);
+	unlink(ipc_path);
+	if (bind(ipc_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+		listen(ipc_fd, 16) < 0) {
+		wlr_log_errno(WLR_ERROR, "failed to listen on %s", ipc_path);
+		close(ipc_fd);
+		ipc_fd = -1;
+		ipc_path[0] = '\0';
+		return;
+	}
+
+	ipc_source = wl_event_loop_add_fd(event_loop, ipc_fd, WL_EVENT_READABLE,
+									  ipc_socket_accept, NULL);
+	setenv("MAOMAO_SOCKET", ipc_path, 1);
+}
+
+void ipc_socket_finish(void) {
+	IpcClient *ic, *tmp;
+
+	if (ipc_fd < 0)
+		return;
+	wl_list_for_each_safe(ic, tmp, &ipc_clients, link)
+		ipc_client_destroy(ic);
+	wl_event_source_remove(ipc_source);
+	ipc_source = NULL;
+	close(ipc_fd);
+	ipc_fd = -1;
+	unlink(ipc_path);
+	ipc_path[0] = '\0';
+}
@@ -0,0 +1,328 @@
+/* 启动程序用的辅助进程。setup() 一开始合成器还很小的时候 fork 出来,
+ * 之后 spawn 只把 argv 和环境变量通过 socketpair 发给它,由它 fork/exec,
+ * 合成器自己不再 fork。辅助进程不在时退回到 posix_spawn。
+ * 消息格式: u32 argc, u32 envc, u32 flags, 然后是 '\0' 结尾的字符串。
+ * 带 LAUNCHER_STDIN 时消息附带一个 fd (SCM_RIGHTS) 接到子进程的 stdin 上,
+ * 辅助进程把子进程的 pid 回给合成器 */
+
+#define LAUNCHER_MSG_MAX 65536
+#define LAUNCHER_HEADER (3 * sizeof(uint32_t))
+
+enum {
+	LAUNCHER_STDIN = 1 << 0, /* 附带 stdin 的 fd,保留 stdout,回复 pid */
+};
+
+typedef struct {
+	struct wl_list link;
+	int fd; /* 随消息发送的 fd,没有为 -1 */
+	size_t len;
+	char data[];
+} LauncherMsg;
+
+static int launcher_fd = -1;
+static pid_t launcher_pid = -1;
+static struct wl_event_source *launcher_source;
+static struct wl_list launcher_queue;
+
+/* 拆开一条消息,返回的数组前 argc 项是 argv,后面是环境变量,
+ * 两段都以 NULL 结尾,字符串还指向 msg 里面 */
+static char **launcher_unpack(char *msg, size_t len, uint32_t *argc,
+							  uint32_t *flags) {
+	char **argv, *p = msg + LAUNCHER_HEADER, *end = msg + len;
+	uint32_t envc, i;
+
+	if (len < LAUNCHER_HEADER || msg[len - 1] != '\0')
+		return NULL;
+	memcpy(argc, msg, sizeof(*argc));
+	memcpy(&envc, msg + sizeof(*argc), sizeof(envc));
+	memcpy(flags, msg + 2 * sizeof(*argc), sizeof(*flags));
+	if (!*argc || *argc > LAUNCHER_MSG_MAX || envc > LAUNCHER_MSG_MAX)
+		return NULL;
+	if (!(argv = calloc(*argc + envc + 2, sizeof(*argv))))
+		return NULL;
+	for (i = 0; i < *argc + envc && p < end; i++, p += strlen(p) + 1)
+		argv[i < *argc ? i : i + 1] = p;
+	if (i != *argc + envc) {
+		free(argv);
+		return NULL;
+	}
+	return argv;
+}
+
+static pid_t launcher_exec(char *msg, size_t len, int fd) {
+	extern char **environ;
+	uint32_t argc, flags;
+	char **argv;
+	struct sigaction sa = {.sa_handler = SIG_DFL};
+	pid_t pid;
+
+	if (!(argv = launcher_unpack(msg, len, &argc, &flags)))
+		return -1;
+
+	if ((pid = fork()) == 0) {
+		sigaction(SIGCHLD, &sa, NULL);
+		setsid();
+		if (fd >= 0) {
+			dup2(fd, STDIN_FILENO);
+			close(fd);
+		}
+		if (!(flags & LAUNCHER_STDIN))
+			dup2(STDERR_FILENO, STDOUT_FILENO);
+		environ = argv + argc + 1;
+		execvp(argv[0], argv);
+		fprintf(stderr, "maomao: execvp '%s' failed: %s\n", argv[0],
+				strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+	free(argv);
+	return pid;
+}
+
+static void launcher_main(int fd) {
+	static char msg[LAUNCHER_MSG_MAX];
+	char ctrl[CMSG_SPACE(sizeof(int))];
+	struct iovec iov = {.iov_base = msg, .iov_len = sizeof(msg)};
+	struct msghdr mh = {.msg_iov = &iov, .msg_iovlen = 1};
+	struct sigaction sa = {.sa_handler = SIG_IGN};
+	int sig[] = {SIGINT, SIGTERM, SIGPIPE};
+	struct cmsghdr *cm;
+	uint32_t flags;
+	ssize_t n;
+	size_t i;
+	pid_t pid;
+	int in;
+
+	// 忽略 SIGCHLD,子进程退出后自动回收
+	sigaction(SIGCHLD, &sa, NULL);
+	sa.sa_handler = SIG_DFL;
+	for (i = 0; i < LENGTH(sig); i++)
+		sigaction(sig[i], &sa, NULL);
+
+	for (;;) {
+		mh.msg_control = ctrl;
+		mh.msg_controllen = sizeof(ctrl);
+		n = recvmsg(fd, &mh, MSG_CMSG_CLOEXEC);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			_exit(0);
+
+		in = -1;
+		for (cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+			if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+				memcpy(&in, CMSG_DATA(cm), sizeof(in));
+		}
+		pid = launcher_exec(msg, n, in);
+		if (in >= 0)
+			close(in);
+
+		// 要 pid 的消息总要回一个,失败时回 -1
+		if (n >= (ssize_t)LAUNCHER_HEADER) {
+			memcpy(&flags, msg + 2 * sizeof(uint32_t), sizeof(flags));
+			if (flags & LAUNCHER_STDIN)
+				send(fd, &pid, sizeof(pid), MSG_NOSIGNAL);
+		}
+	}
+}
+
+void launcher_start(void) {
+	int sv[2];
+
+	wl_list_init(&launcher_queue);
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0) {
+		wlr_log_errno(WLR_ERROR, "launcher socketpair failed");
+		return;
+	}
+	if ((launcher_pid = fork()) < 0) {
+		wlr_log_errno(WLR_ERROR, "launcher fork failed");
+		close(sv[0]);
+		close(sv[1]);
+		return;
+	}
+	if (launcher_pid == 0) {
+		close(sv[0]);
+		launcher_main(sv[1]);
+	}
+	close(sv[1]);
+	launcher_fd = sv[0];
+	fd_set_nonblock(launcher_fd);
+}
+
+void launcher_finish(void) {
+	LauncherMsg *msg, *tmp;
+
+	if (launcher_source) {
+		wl_event_source_remove(launcher_source);
+		launcher_source = NULL;
+	}
+	if (launcher_fd >= 0) {
+		// 辅助进程读到 EOF 后自己退出
+		close(launcher_fd);
+		launcher_fd = -1;
+	}
+	launcher_pid = -1;
+	wl_list_for_each_safe(msg, tmp, &launcher_queue, link) {
+		wl_list_remove(&msg->link);
+		if (msg->fd >= 0)
+			close(msg->fd);
+		free(msg);
+	}
+}
+
+/* 辅助进程不在了,还没发出去的消息在这里用 posix_spawn 启动,
+ * 调用 spawn 的地方已经当它启动过了 */
+static void launcher_replay(LauncherMsg *msg) {
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	uint32_t argc, flags;
+	char **argv;
+	pid_t pid;
+	int err;
+
+	if (!(argv = launcher_unpack(msg->data, msg->len, &argc, &flags)))
+		return;
+	posix_spawn_file_actions_init(&actions);
+	if (msg->fd >= 0)
+		posix_spawn_file_actions_adddup2(&actions, msg->fd, STDIN_FILENO);
+	if (!(flags & LAUNCHER_STDIN))
+		posix_spawn_file_actions_adddup2(&actions, STDERR_FILENO,
+										 STDOUT_FILENO);
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+
+	err = posix_spawnp(&pid, argv[0], &actions, &attr, argv, argv + argc + 1);
+	if (err)
+		wlr_log(WLR_ERROR, "spawn '%s' failed: %s", argv[0], strerror(err));
+	else if (flags & LAUNCHER_STDIN)
+		child_pid = pid;
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+	free(argv);
+}
+
+static void launcher_fail(void) {
+	LauncherMsg *msg;
+
+	wl_list_for_each(msg, &launcher_queue, link) {
+		launcher_replay(msg);
+	}
+	launcher_finish();
+}
+
+// 发送排队的消息,辅助进程不在了就把剩下的直接启动
+static void launcher_flush(void) {
+	char ctrl[CMSG_SPACE(sizeof(int))] = {0};
+	struct iovec iov;
+	struct msghdr mh;
+	struct cmsghdr *cm;
+	LauncherMsg *msg, *tmp;
+	ssize_t n;
+
+	wl_list_for_each_safe(msg, tmp, &launcher_queue, link) {
+		iov = (struct iovec){.iov_base = msg->data, .iov_len = msg->len};
+		mh = (struct msghdr){.msg_iov = &iov, .msg_iovlen = 1};
+		if (msg->fd >= 0) {
+			mh.msg_control = ctrl;
+			mh.msg_controllen = sizeof(ctrl);
+			cm = CMSG_FIRSTHDR(&mh);
+			cm->cmsg_level = SOL_SOCKET;
+			cm->cmsg_type = SCM_RIGHTS;
+			cm->cmsg_len = CMSG_LEN(sizeof(int));
+			memcpy(CMSG_DATA(cm), &msg->fd, sizeof(int));
+		}
+		do {
+			n = sendmsg(launcher_fd, &mh, MSG_NOSIGNAL);
+		} while (n < 0 && errno == EINTR);
+		if (n < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			wlr_log_errno(WLR_ERROR, "launcher died");
+			launcher_fail();
+			return;
+		}
+		wl_list_remove(&msg->link);
+		if (msg->fd >= 0)
+			close(msg->fd);
+		free(msg);
+	}
+
+	if (launcher_source)
+		wl_event_source_fd_update(launcher_source,
+								  WL_EVENT_READABLE |
+									  (wl_list_empty(&launcher_queue)
+										   ? 0
+										   : WL_EVENT_WRITABLE));
+}
+
+int launcher_handle(int fd, uint32_t mask, void *data) {
+	pid_t pid;
+
+	// 只有 autostart 脚本会要 pid,退出时要用它结束整个会话
+	if (mask & (WL_EVENT_READABLE | WL_EVENT_HANGUP)) {
+		while (recv(fd, &pid, sizeof(pid), 0) == sizeof(pid))
+			child_pid = pid;
+	}
+	if (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR)) {
+		wlr_log(WLR_ERROR, "launcher exited, spawning directly");
+		launcher_fail();
+		return 0;
+	}
+	if (mask & WL_EVENT_WRITABLE)
+		launcher_flush();
+	return 0;
+}
+
+/* 把 argv 和当前的环境变量打包发给辅助进程。环境变量每次都带上,
+ * WAYLAND_DISPLAY、DISPLAY 和配置里的 env 都是辅助进程启动后才设置的。
+ * stdin_fd 不为 -1 时复制一份接到子进程的 stdin 上,原来的 fd 调用方自己关 */
+bool launcher_spawn_stdin(char **argv, int stdin_fd) {
+	extern char **environ;
+	uint32_t argc = 0, envc = 0, flags = stdin_fd >= 0 ? LAUNCHER_STDIN : 0;
+	size_t len = LAUNCHER_HEADER, n;
+	LauncherMsg *msg;
+	char **s, *p;
+
+	if (launcher_fd < 0)
+		return false;
+	if (!launcher_source && event_loop)
+		launcher_source =
+			wl_event_loop_add_fd(event_loop, launcher_fd, WL_EVENT_READABLE,
+								 launcher_handle, NULL);
+
+	for (s = argv; *s; s++, argc++)
+		len += strlen(*s) + 1;
+	for (s = environ; s && *s; s++, envc++)
+		len += strlen(*s) + 1;
+	if (len > LAUNCHER_MSG_MAX || !(msg = malloc(sizeof(*msg) + len)))
+		return false;
+
+	msg->len = len;
+	msg->fd = -1;
+	memcpy(msg->data, &argc, sizeof(argc));
+	memcpy(msg->data + sizeof(argc), &envc, sizeof(envc));
+	memcpy(msg->data + 2 * sizeof(argc), &flags, sizeof(flags));
+	p = msg->data + LAUNCHER_HEADER;
+	for (s = argv; *s; s++, p += n) {
+		n = strlen(*s) + 1;
+		memcpy(p, *s, n);
+	}
+	for (s = environ; s && *s; s++, p += n) {
+		n = strlen(*s) + 1;
+		memcpy(p, *s, n);
+	}
+
+	if (stdin_fd >= 0 && (msg->fd = fcntl(stdin_fd, F_DUPFD_CLOEXEC, 0)) < 0) {
+		free(msg);
+		return false;
+	}
+
+	// 前面还有没发完的就排在后面,保证启动顺序。进了队列总会被启动
+	wl_list_insert(launcher_queue.prev, &msg->link);
+	launcher_flush();
+	return true;
+}
+
+bool launcher_spawn(char **argv) {
+	return launcher_spawn_stdin(argv, -1);
+}
@@ -0,0 +1,183 @@
+/* 启动队列。autostart 脚本和 exec/exec-once 不在 run() 里直接启动,
+ * 先排队,等第一个输出提交了一帧再从事件循环里一个一个启动,
+ * 配置了多少启动程序都不影响第一帧出来的时间。
+ * 命令前面写 "+<毫秒> " 可以让它晚一点启动,如 exec-once=+2000 nm-applet */
+
+#define STARTUP_STAGGER_MS 10	/* 相邻两个命令之间至少隔这么久 */
+#define STARTUP_FALLBACK_MS 1000 /* 一直没有输出出帧时也在这之后开始 */
+
+typedef struct {
+	struct wl_list link;
+	long due; /* 第一帧之前是相对第一帧的延迟,之后是 CLOCK_MONOTONIC 毫秒 */
+	bool autostart;
+	char cmd[];
+} StartupEntry;
+
+static struct wl_list startup_queue;
+static struct wl_event_source *startup_timer;
+static bool startup_ready;
+
+static long startup_now(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* autostart 脚本的 stdin 接到合成器的 stdout 上。管道在这里建好,
+ * 读端交给辅助进程接到脚本的 stdin,合成器自己不 fork;
+ * 辅助进程不在时用 posix_spawn */
+static void startup_autostart(const char *cmd) {
+	extern char **environ;
+	char *argv[] = {"/bin/sh", "-c", (char *)cmd, NULL};
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	int piperw[2], err;
+
+	if (pipe(piperw) < 0) {
+		wlr_log_errno(WLR_ERROR, "startup: pipe");
+		return;
+	}
+	fcntl(piperw[0], F_SETFD, FD_CLOEXEC);
+	fcntl(piperw[1], F_SETFD, FD_CLOEXEC);
+
+	if (!launcher_spawn_stdin(argv, piperw[0])) {
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_adddup2(&actions, piperw[0], STDIN_FILENO);
+		posix_spawnattr_init(&attr);
+		posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+		err = posix_spawn(&child_pid, argv[0], &actions, &attr, argv, environ);
+		posix_spawnattr_destroy(&attr);
+		posix_spawn_file_actions_destroy(&actions);
+		if (err) {
+			wlr_log(WLR_ERROR, "startup: spawn '%s' failed: %s", cmd,
+					strerror(err));
+			child_pid = -1;
+			close(piperw[0]);
+			close(piperw[1]);
+			return;
+		}
+	}
+	dup2(piperw[1], STDOUT_FILENO);
+	close(piperw[1]);
+	close(piperw[0]);
+
+	/* Mark stdout as non-blocking to avoid people who does not close stdin
+	 * nor consumes it in their startup script getting dwl frozen */
+	if (fd_set_nonblock(STDOUT_FILENO) < 0)
+		close(STDOUT_FILENO);
+}
+
+static void startup_queue_schedule(long min_delay) {
+	StartupEntry *e;
+	long delay;
+
+	if (!startup_ready || wl_list_empty(&startup_queue))
+		return;
+	e = wl_container_of(startup_queue.next, e, link);
+	delay = e->due - startup_now();
+	// 超时设成 0 会关掉定时器
+	wl_event_source_timer_update(startup_timer,
+								 delay > min_delay ? delay : min_delay);
+}
+
+static void startup_queue_start(void) {
+	StartupEntry *e;
+	long now = startup_now();
+
+	startup_ready = true;
+	wl_list_for_each(e, &startup_queue, link) {
+		e->due += now;
+	}
+	startup_queue_schedule(1);
+}
+
+int startup_queue_run(void *data) {
+	StartupEntry *e;
+	Arg arg = {0};
+
+	if (!startup_ready) {
+		wlr_log(WLR_INFO, "no frame yet, starting startup programs anyway");
+		startup_queue_start();
+		return 0;
+	}
+	if (wl_list_empty(&startup_queue))
+		return 0;
+
+	// 一次只启动一个,中间回到事件循环处理输入和绘制
+	e = wl_container_of(startup_queue.next, e, link);
+	if (e->due > startup_now()) {
+		startup_queue_schedule(1);
+		return 0;
+	}
+	wl_list_remove(&e->link);
+	if (e->autostart) {
+		startup_autostart(e->cmd);
+	} else {
+		arg.v = e->cmd;
+		spawn(&arg);
+	}
+	free(e);
+	startup_queue_schedule(STARTUP_STAGGER_MS);
+	return 0;
+}
+
+void startup_queue_init(void) {
+	wl_list_init(&startup_queue);
+	startup_timer =
+		wl_event_loop_add_timer(event_loop, startup_queue_run, NULL);
+	// 第一帧迟迟不来 (比如没有输出) 时也不能一直不启动
+	wl_event_source_timer_update(startup_timer, STARTUP_FALLBACK_MS);
+}
+
+void startup_queue_push(const char *cmd, bool autostart) {
+	StartupEntry *e, *pos;
+	long delay = 0;
+	char *end;
+
+	if (!startup_timer)
+		return;
+	if (!autostart && cmd[0] == '+' && isdigit((unsigned char)cmd[1])) {
+		delay = strtol(cmd + 1, &end, 10);
+		if (*end == ' ' || *end == '\t') {
+			for (cmd = end; *cmd == ' ' || *cmd == '\t'; cmd++)
+				;
+		} else {
+			delay = 0;
+		}
+	}
+	if (!*cmd)
+		return;
+
+	e = ecalloc(1, sizeof(*e) + strlen(cmd) + 1);
+	strcpy(e->cmd, cmd);
+	e->autostart = autostart;
+	e->due = startup_ready ? startup_now() + delay : delay;
+
+	// 按时间排序,时间相同的保持配置里的顺序
+	wl_list_for_each(pos, &startup_queue, link) {
+		if (pos->due > e->due)
+			break;
+	}
+	wl_list_insert(pos->link.prev, &e->link);
+	startup_queue_schedule(1);
+}
+
+// 在 rendermon 里调用,第一次有输出出帧时开始启动
+void startup_frame_done(void) {
+	if (!startup_ready && startup_timer)
+		startup_queue_start();
+}
+
+void startup_queue_finish(void) {
+	StartupEntry *e, *tmp;
+
+	if (!startup_timer)
+		return;
+	wl_event_source_remove(startup_timer);
+	startup_timer = NULL;
+	wl_list_for_each_safe(e, tmp, &startup_queue, link) {
+		wl_list_remove(&e->link);
+		free(e);
+	}
+}
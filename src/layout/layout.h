@@ -1,3 +1,11 @@
+// 单窗口开关时,目标位置没变且已静止的窗口不再重新配置
+static void layout_resize(Client *c, struct wlr_box geo) {
+	if (arrange_skip_steady && client_is_steady(c) &&
+		wlr_box_equal(&geo, &c->geom))
+		return;
+	resize(c, geo, 0);
+}
+
 void fibonacci(Monitor *mon, int s) {
 	unsigned int i = 0, n = 0, nx, ny, nw, nh;
 	Client *c;
@@ -351,7 +359,7 @@ void scroller(Monitor *m) {
 			(m->w.width - 2 * cur_gappoh) * scroller_default_proportion_single;
 		target_geom.x = m->w.x + (m->w.width - target_geom.width) / 2;
 		target_geom.y = m->w.y + (m->w.height - target_geom.height) / 2;
-		resize(c, target_geom, 0);
+		layout_resize(c, target_geom);
 		free(tempClients); // 释放内存
 		return;
 	}
@@ -408,10 +416,10 @@ void scroller(Monitor *m) {
 											scroller_structs)
 								: m->w.x + scroller_structs;
 		}
-		resize(tempClients[focus_client_index], target_geom, 0);
+		layout_resize(tempClients[focus_client_index], target_geom);
 	} else {
 		target_geom.x = c->geom.x;
-		resize(tempClients[focus_client_index], target_geom, 0);
+		layout_resize(tempClients[focus_client_index], target_geom);
 	}
 
 	for (i = 1; i <= focus_client_index; i++) {
@@ -419,7 +427,7 @@ void scroller(Monitor *m) {
 		target_geom.width = max_client_width * c->scroller_proportion;
 		target_geom.x = tempClients[focus_client_index - i + 1]->geom.x -
 						cur_gappih - target_geom.width;
-		resize(c, target_geom, 0);
+		layout_resize(c, target_geom);
 	}
 
 	for (i = 1; i < n - focus_client_index; i++) {
@@ -428,7 +436,7 @@ void scroller(Monitor *m) {
 		target_geom.x = tempClients[focus_client_index + i - 1]->geom.x +
 						cur_gappih +
 						tempClients[focus_client_index + i - 1]->geom.width;
-		resize(c, target_geom, 0);
+		layout_resize(c, target_geom);
 	}
 
 	free(tempClients); // 最后释放内存
@@ -467,22 +475,19 @@ void tile(Monitor *m) {
 		if (i < selmon->pertag->nmasters[selmon->pertag->curtag]) {
 			r = MIN(n, selmon->pertag->nmasters[selmon->pertag->curtag]) - i;
 			h = (m->w.height - my - cur_gappoh - cur_gappih * ie * (r - 1)) / r;
-			resize(c,
-				   (struct wlr_box){.x = m->w.x + cur_gappov,
-									.y = m->w.y + my,
-									.width = mw - cur_gappiv * ie,
-									.height = h},
-				   0);
+			layout_resize(c, (struct wlr_box){.x = m->w.x + cur_gappov,
+										  .y = m->w.y + my,
+										  .width = mw - cur_gappiv * ie,
+										  .height = h});
 			my += c->geom.height + cur_gappih * ie;
 		} else {
 			r = n - i;
 			h = (m->w.height - ty - cur_gappoh - cur_gappih * ie * (r - 1)) / r;
-			resize(c,
-				   (struct wlr_box){.x = m->w.x + mw + cur_gappov,
-									.y = m->w.y + ty,
-									.width = m->w.width - mw - 2 * cur_gappov,
-									.height = h},
-				   0);
+			layout_resize(c,
+						  (struct wlr_box){.x = m->w.x + mw + cur_gappov,
+											   .y = m->w.y + ty,
+											   .width = m->w.width - mw - 2 * cur_gappov,
+											   .height = h});
 			ty += c->geom.height + cur_gappih * ie;
 		}
 		i++;
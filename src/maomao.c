@@ -7,6 +7,7 @@
 #include <limits.h>
 #include <linux/input-event-codes.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -89,6 +90,10 @@
 #define MIN(A, B) ((A) < (B) ? (A) : (B))
 #define GEZERO(A) ((A) >= 0 ? (A) : 0)
 #define CLEANMASK(mask) (mask & ~WLR_MODIFIER_CAPS)
+#define WINRULE_HIT(bits, i)                                                   \
+	(((bits)[(i) / (sizeof(unsigned long) * 8)] >>                             \
+	  ((i) % (sizeof(unsigned long) * 8))) &                                   \
+	 1)
 #define ISTILED(A)                                                             \
 	(!(A)->isfloating && !(A)->isminied && !(A)->iskilling &&                  \
 	 !client_should_ignore_focus(A) && !(A)->isunglobal &&                     \
@@ -110,6 +115,12 @@
 	} while (0)
 
 #define BAKED_POINTS_COUNT 256
+#define SPAWN_MAX_ARGS 63
+#define SPAWN_SEP "\x1f"	/* spawn_tokenize 切好的参数之间的分隔符 */
+#define SPAWN_EXPAND '\x1e' /* 这个参数执行时还要 wordexp */
+#ifndef POSIX_SPAWN_SETSID
+#define POSIX_SPAWN_SETSID 0x80 /* glibc 和 musl 只在 _GNU_SOURCE 下定义 */
+#endif
 
 /* enums */
 enum { VERTICAL, HORIZONTAL };
@@ -206,21 +217,60 @@ typedef struct {
 
 typedef struct Client Client;
 struct Client {
-	/* Must keep these three elements in this order */
+	/* Must keep type first, it is read before knowing Client or LayerSurface */
 	unsigned int type; /* XDGShell or X11* */
-	struct wlr_box geom, pending, oldgeom, scratchpad_geom, animainit_geom,
-		overview_backup_geom, current; /* layout-relative, includes border */
+	/* 下面到 animation 为止是 arrange、rendermon、布局和每帧动画会读的字段,
+	 * 监听器、规则、备份和进程信息放在后面 */
+	unsigned int tags;
 	Monitor *mon;
-	struct wlr_scene_tree *scene;
-	struct wlr_scene_rect *border[4]; /* top, bottom, left, right */
-	struct wlr_scene_tree *scene_surface;
 	struct wl_list link;
-	struct wl_list flink;
-	struct wl_list fadeout_link;
 	union {
 		struct wlr_xdg_surface *xdg;
 		struct wlr_xwayland_surface *xwayland;
 	} surface;
+	struct wlr_scene_tree *scene;
+	int iskilling, isglobal, isunglobal;
+	bool need_output_flush;
+	bool is_clip_to_hide;
+	bool is_open_animation;
+	bool fake_no_border;
+	struct wlr_box geom, pending, current,
+		animainit_geom; /* layout-relative, includes border */
+	unsigned int bw;
+	int isfloating, isminied, isfullscreen, ismaxmizescreen, isnoborder;
+	int is_in_scratchpad, is_scratchpad_show;
+	int overview_isfullscreenbak, overview_ismaxmizescreenbak; /* ISFULLSCREEN */
+	float scroller_proportion;
+	struct wlr_scene_rect *border[4]; /* top, bottom, left, right */
+	struct wlr_scene_tree *scene_surface;
+	struct wl_list fadeout_link;
+	struct dwl_animation animation;
+
+	struct wl_list flink;
+	unsigned int oldtags, mini_restore_tag;
+	int isurgent, isfakefullscreen, need_float_size_reduce, isoverlay;
+	bool dirty;
+	unsigned int configure_serial;
+	struct wlr_box oldgeom, scratchpad_geom, overview_backup_geom, bounds;
+	/* 计入 pertag 计数时的状态,变化时先减去旧值再加上新值 */
+	Monitor *tagcount_mon;
+	unsigned int tagcount_tags;
+	int tagcount_urgent;
+	int tagcount_listed; /* 在 clients 链表里 */
+	unsigned int ipc_id; /* socket IPC 里的窗口 id */
+	int overview_backup_bw;
+	int fullscreen_backup_x, fullscreen_backup_y, fullscreen_backup_w,
+		fullscreen_backup_h;
+	int overview_isfloatingbak;
+	bool is_restoring_from_ov;
+	bool drag_to_tile;
+	int isopensilent;
+	int isopenscratchpad;
+	int isnamedscratchpand;
+	int nofadein;
+	int nofadeout;
+	int no_force_center;
+
 	struct wl_listener commit;
 	struct wl_listener map;
 	struct wl_listener maximize;
@@ -228,6 +278,7 @@ struct Client {
 	struct wl_listener unmap;
 	struct wl_listener destroy;
 	struct wl_listener set_title;
+	struct wl_listener set_appid;
 	struct wl_listener fullscreen;
 #ifdef XWAYLAND
 	struct wl_listener activate;
@@ -237,20 +288,7 @@ struct Client {
 	struct wl_listener set_hints;
 	struct wl_listener set_geometry;
 #endif
-	unsigned int bw;
-	unsigned int tags, oldtags, mini_restore_tag;
-	bool dirty;
-	unsigned int configure_serial;
 	struct wlr_foreign_toplevel_handle_v1 *foreign_toplevel;
-	int isfloating, isurgent, isfullscreen, isfakefullscreen,
-		need_float_size_reduce, isminied, isoverlay;
-	int ismaxmizescreen;
-	int overview_backup_bw;
-	int fullscreen_backup_x, fullscreen_backup_y, fullscreen_backup_w,
-		fullscreen_backup_h;
-	int overview_isfullscreenbak, overview_ismaxmizescreenbak,
-		overview_isfloatingbak;
-
 	struct wlr_xdg_toplevel_decoration_v1 *decoration;
 	struct wl_listener foreign_activate_request;
 	struct wl_listener foreign_fullscreen_request;
@@ -261,37 +299,34 @@ struct Client {
 
 	const char *animation_type_open;
 	const char *animation_type_close;
-	int is_in_scratchpad;
-	int is_scratchpad_show;
-	int isglobal;
-	int isnoborder;
-	int isopensilent;
-	int isopenscratchpad;
-	int iskilling;
-	int isnamedscratchpand;
-	struct wlr_box bounds;
-	bool is_open_animation;
-	bool is_restoring_from_ov;
-	float scroller_proportion;
-	bool need_output_flush;
-	struct dwl_animation animation;
+	unsigned long *rule_matches; /* bit i: 规则槽位 i 命中该窗口 */
+	unsigned int rule_match_generation; /* 缓存对应的 config_generation */
+	uint32_t rule_match_hash;			/* 缓存对应的 (appid, title) 哈希 */
 	int isterm, noswallow;
+	int pidfd; /* 终端进程的 pidfd,pidfd_source 不为空时有效 */
+	struct wl_event_source *pidfd_source;
+	bool pid_exited;
 	pid_t pid;
 	Client *swallowing, *swallowedby;
-	bool is_clip_to_hide;
-	bool drag_to_tile;
-	bool fake_no_border;
-	int nofadein;
-	int nofadeout;
-	int no_force_center;
-	int isunglobal;
-	char oldmonname[128];
+	unsigned int oldmon_id; /* 要恢复到的输出的名字编号,0 表示没有 */
 };
 
+typedef struct {
+	unsigned int state, clients, focused;
+} DwlIpcTag;
+
 typedef struct {
 	struct wl_list link;
 	struct wl_resource *resource;
 	Monitor *mon;
+	/* 上一次发送给客户端的状态,v3 起只发送变化的字段 */
+	bool sent;
+	unsigned int active, layout;
+	DwlIpcTag *tags;
+	char *title, *appid;
+	const char *symbol;
+	unsigned int fullscreen, floating;
+	int x, y, width, height;
 } DwlIpcOutput;
 
 typedef struct {
@@ -356,6 +391,7 @@ typedef struct {
 struct Monitor {
 	struct wl_list link;
 	struct wlr_output *wlr_output;
+	unsigned int name_id; /* output_name_intern 给的编号 */
 	struct wlr_scene_output *scene_output;
 	// struct wlr_scene_rect *fullscreen_bg; /* See createmon() for info */
 	struct wl_listener frame;
@@ -384,6 +420,11 @@ struct Monitor {
 	int gamma_lut_changed;
 	int asleep;
 	unsigned int visible_clients;
+	int status_dirty; /* dwl-ipc 状态等待 idle 时统一发送 */
+	/* 上次发给 socket IPC 订阅者的状态 */
+	unsigned int ipc_tagset, ipc_occupied, ipc_urgent;
+	const Layout *ipc_layout;
+	bool arrange_pending, arrange_pending_animation; /* 批量执行时推迟的 */
 };
 
 typedef struct {
@@ -425,6 +466,12 @@ typedef struct {
 	struct wl_listener destroy;
 } SessionLock;
 
+typedef struct {
+	pid_t pid, ppid;
+	unsigned long long starttime; /* /proc/<pid>/stat 第 22 项 */
+	long checked;				  /* 读取时的 CLOCK_MONOTONIC 毫秒 */
+} ProcEntry;
+
 /* function declarations */
 static void applybounds(
 	Client *c,
@@ -529,6 +576,13 @@ static void outputmgrtest(struct wl_listener *listener, void *data);
 static void pointerfocus(Client *c, struct wlr_surface *surface, double sx,
 						 double sy, unsigned int time);
 static void printstatus(void);
+static void printstatus_flush(void *data);
+static void client_update_tagcount(Client *c);
+static void client_set_listed(Client *c, int listed);
+static FuncType parse_dispatch(char *cmd, Arg *arg);
+static char *next_dispatch(char *cmds, char **rest);
+static bool run_dispatch(char *cmd);
+static int run_dispatch_batch(char *cmds, int *count);
 static void quitsignal(int signo);
 static void powermgrsetmode(struct wl_listener *listener, void *data);
 static void rendermon(struct wl_listener *listener, void *data);
@@ -574,8 +628,13 @@ static Monitor *xytomon(double x, double y);
 static void xytonode(double x, double y, struct wlr_surface **psurface,
 					 Client **pc, LayerSurface **pl, double *nx, double *ny);
 static void clear_fullscreen_flag(Client *c);
-static pid_t getparentprocess(pid_t p);
-static int isdescprocess(pid_t p, pid_t c);
+static pid_t getparentprocess(pid_t p, unsigned long long *start);
+static char *spawn_tokenize(const char *cmd);
+static void launcher_start(void);
+static void launcher_finish(void);
+static bool launcher_spawn(char **argv);
+static bool launcher_spawn_stdin(char **argv, int stdin_fd);
+static void startup_queue_push(const char *cmd, bool autostart);
 static Client *termforwin(Client *w);
 static void swallow(Client *c, Client *w);
 
@@ -615,8 +674,28 @@ static void handlecursoractivity(void);
 static int hidecursor(void *data);
 static bool check_hit_no_border(Client *c);
 static void reset_keyboard_layout(void);
-static void client_update_oldmonname_record(Client *c, Monitor *m);
+static void config_watch_update(void);
+static void proc_events_update(void);
+static void proc_events_finish(void);
+static bool proc_tree_parent(pid_t pid, pid_t *ppid);
+static void client_watch_pid(Client *c);
+static void client_unwatch_pid(Client *c);
+static void ipc_socket_init(const char *display);
+static void ipc_socket_finish(void);
+static void ipc_socket_status(Monitor *m);
+static void ipc_socket_focus(void);
+static void ipc_event_client(unsigned int event, Client *c,
+							 const char *change);
+static bool config_cache_load(const char *config_file);
+static void config_cache_save(void);
+static void client_update_oldmon_record(Client *c, Monitor *m);
+static unsigned int output_name_intern(const char *name);
 static void pending_kill_client(Client *c);
+static bool client_is_steady(Client *c);
+static void updateappid(struct wl_listener *listener, void *data);
+static uint32_t client_rule_hash(Client *c);
+static const unsigned long *client_rule_matches(Client *c);
+static bool client_rule_hit(Client *c, int ji);
 
 #include "data/static_keymap.h"
 #include "dispatch/dispatch.h"
@@ -629,6 +708,7 @@ static unsigned int locked_mods = 0;
 static void *exclusive_focus;
 static struct wl_display *dpy;
 static struct wl_event_loop *event_loop;
+static struct wl_event_source *printstatus_idle;
 static struct wlr_relative_pointer_manager_v1 *pointer_manager;
 static struct wlr_backend *backend;
 static struct wlr_backend *headless_backend;
@@ -644,6 +724,18 @@ static struct wlr_xdg_decoration_manager_v1 *xdg_decoration_mgr;
 static struct wl_list clients; /* tiling order */
 static struct wl_list fstack;  /* focus order */
 static struct wl_list fadeout_clients;
+/* 窗口开关很频繁,这几种对象从 slab 池里分配,get_stats 能看到用量 */
+static Pool client_pool = {.name = "client", .size = sizeof(Client)};
+static Pool fadeout_pool = {.name = "fadeout", .size = sizeof(Client)};
+static Pool layer_pool = {.name = "layer_surface",
+						  .size = sizeof(LayerSurface)};
+static Pool keyboard_group_pool = {.name = "keyboard_group",
+								   .size = sizeof(KeyboardGroup)};
+static Pool *const pools[] = {&client_pool, &fadeout_pool, &layer_pool,
+							  &keyboard_group_pool};
+/* 出现过的输出名字,下标加一就是编号 */
+static char **output_names;
+static unsigned int output_names_count;
 static struct wlr_idle_notifier_v1 *idle_notifier;
 static struct wlr_idle_inhibit_manager_v1 *idle_inhibit_mgr;
 static struct wlr_layer_shell_v1 *layer_shell;
@@ -684,6 +776,12 @@ static int enablegaps = 1; /* enables gaps, used by togglegaps */
 static int axis_apply_time = 0;
 static int axis_apply_dir = 0;
 static int scroller_focus_lock = 0;
+static bool arrange_incremental = false; /* set while one client maps/unmaps */
+static bool arrange_skip_steady = false; /* active inside arrange() */
+static int arrange_batch = 0; /* >0 时 arrange 推迟到 batch 结束统一执行 */
+
+#define PROC_CACHE_TTL_MS 2000
+static ProcEntry proc_cache[256]; /* pid -> ppid,按 pid 直接映射 */
 
 static unsigned int swipe_fingers = 0;
 static double swipe_dx = 0;
@@ -714,6 +812,8 @@ struct Pertag {
 	float smfacts[LENGTH(tags) + 1]; /* smfacts per tag */
 	const Layout
 		*ltidxs[LENGTH(tags) + 1]; /* matrix of tags and layouts indexes  */
+	unsigned int nclients[LENGTH(tags)]; /* clients on each tag */
+	unsigned int nurgent[LENGTH(tags)];	 /* urgent clients on each tag */
 };
 
 static struct wl_listener cursor_axis = {.notify = axisnotify};
@@ -762,8 +862,14 @@ static struct wlr_xwayland *xwayland;
 #endif
 
 #include "client/client.h"
+#include "client/proc.h"
 #include "config/parse_config.h"
+#include "config/watch.h"
+#include "config/cache.h"
 #include "ext-protocol/all.h"
+#include "ipc/ipc.h"
+#include "launcher/launcher.h"
+#include "launcher/startup.h"
 #include "layout/layout.h"
 
 struct dvec2 calculate_animation_curve_at(double t, int type) {
@@ -791,12 +897,27 @@ struct dvec2 calculate_animation_curve_at(double t, int type) {
 }
 
 void init_baked_points(void) {
+	free_baked_points();
 	baked_points_move = calloc(BAKED_POINTS_COUNT, sizeof(*baked_points_move));
 	baked_points_open = calloc(BAKED_POINTS_COUNT, sizeof(*baked_points_open));
 	baked_points_tag = calloc(BAKED_POINTS_COUNT, sizeof(*baked_points_tag));
 	baked_points_close =
 		calloc(BAKED_POINTS_COUNT, sizeof(*baked_points_close));
 
+	// 配置缓存里已经有按同样曲线烘焙好的点
+	if (config.baked_points) {
+		memcpy(baked_points_move, config.baked_points,
+			   BAKED_POINTS_COUNT * sizeof(*baked_points_move));
+		memcpy(baked_points_open, config.baked_points + BAKED_POINTS_COUNT,
+			   BAKED_POINTS_COUNT * sizeof(*baked_points_open));
+		memcpy(baked_points_tag, config.baked_points + 2 * BAKED_POINTS_COUNT,
+			   BAKED_POINTS_COUNT * sizeof(*baked_points_tag));
+		memcpy(baked_points_close,
+			   config.baked_points + 3 * BAKED_POINTS_COUNT,
+			   BAKED_POINTS_COUNT * sizeof(*baked_points_close));
+		return;
+	}
+
 	for (unsigned int i = 0; i < BAKED_POINTS_COUNT; i++) {
 		baked_points_move[i] = calculate_animation_curve_at(
 			(double)i / (BAKED_POINTS_COUNT - 1), MOVE);
@@ -947,7 +1068,7 @@ void fadeout_client_animation_next_tick(Client *c) {
 	if (animation_passed == 1.0) {
 		wl_list_remove(&c->fadeout_link);
 		wlr_scene_node_destroy(&c->scene->node);
-		free(c);
+		pool_free(&fadeout_pool, c);
 		c = NULL;
 	} else {
 		c->animation.passed_frames++;
@@ -1040,6 +1161,157 @@ void set_rect_size(struct wlr_scene_rect *rect, int width, int height) {
 	wlr_scene_rect_set_size(rect, GEZERO(width), GEZERO(height));
 }
 
+static void tagcount_add(Monitor *m, unsigned int mask, int urgent,
+						 int delta) {
+	unsigned int i;
+
+	if (!m)
+		return;
+	for (i = 0; i < LENGTH(tags); i++) {
+		if (!(mask & (1 << i)))
+			continue;
+		m->pertag->nclients[i] += delta;
+		if (urgent)
+			m->pertag->nurgent[i] += delta;
+	}
+}
+
+// 窗口的显示器、tag 或紧急状态变化后调用,状态栏发送时不用再遍历所有窗口
+void client_update_tagcount(Client *c) {
+	Monitor *m = c->tagcount_listed ? c->mon : NULL;
+	unsigned int mask = m ? c->tags & TAGMASK : 0;
+	int urgent = m && c->isurgent;
+
+	if (m == c->tagcount_mon && mask == c->tagcount_tags &&
+		urgent == c->tagcount_urgent)
+		return;
+	tagcount_add(c->tagcount_mon, c->tagcount_tags, c->tagcount_urgent, -1);
+	tagcount_add(m, mask, urgent, 1);
+	c->tagcount_mon = m;
+	c->tagcount_tags = mask;
+	c->tagcount_urgent = urgent;
+}
+
+void client_set_listed(Client *c, int listed) {
+	c->tagcount_listed = listed;
+	client_update_tagcount(c);
+}
+
+/* 执行一条 "func arg1,arg2,..." 形式的命令,参数和配置文件里的 bind
+ * 一样用逗号分隔,最后一个参数包含剩下的全部内容 */
+FuncType parse_dispatch(char *cmd, Arg *arg) {
+	char empty[] = "";
+	char *args[6] = {cmd, empty, empty, empty, empty, empty};
+	char *p, *sep;
+	int i, count;
+
+	sep = cmd + strcspn(cmd, ", \t");
+	for (count = 1; *sep && count < 6; count++) {
+		*sep = '\0';
+		p = sep + 1;
+		args[count] = p;
+		sep = count < 5 ? p + strcspn(p, ",") : p + strlen(p);
+	}
+	for (i = 0; i < count; i++)
+		trim_whitespace(args[i]);
+
+	if (args[0][0] == '\0')
+		return NULL;
+	return parse_func_name(args[0], arg, args[1], args[2], args[3], args[4],
+						   args[5]);
+}
+
+bool run_dispatch(char *cmd) {
+	FuncType func;
+	Arg arg = {0};
+
+	if (!(func = parse_dispatch(cmd, &arg)))
+		return false;
+	func(&arg);
+	free(arg.v);
+	free(arg.v2);
+	free(arg.v3);
+	return true;
+}
+
+/* 在 ';' 处切开 cmds,返回下一条命令的开头,没有了返回 NULL。
+ * 引号里的 ';' 和 "\;" 不算分隔符,"\;" 换成 ';',引号原样保留 */
+char *next_dispatch(char *cmds, char **rest) {
+	char *r, *w, quote = '\0';
+
+	if (!cmds)
+		return NULL;
+	for (r = w = cmds; *r; r++) {
+		if (*r == '\\' && r[1] == ';') {
+			*w++ = *++r;
+			continue;
+		}
+		if (quote) {
+			if (*r == quote)
+				quote = '\0';
+		} else if (*r == '\'' || *r == '"') {
+			quote = *r;
+		} else if (*r == ';') {
+			*w = '\0';
+			*rest = r + 1;
+			return cmds;
+		}
+		*w++ = *r;
+	}
+	*w = '\0';
+	*rest = NULL;
+	return cmds;
+}
+
+/* 执行用 ';' 分隔的多条命令,期间的 arrange 都推迟到最后每个显示器只做一次,
+ * 状态栏本来就在 idle 时统一刷新。先把每条都解析好,有一条解析不了就一条都不执行,
+ * 返回解析失败的命令数 */
+int run_dispatch_batch(char *cmds, int *count) {
+	char *cmd, *rest;
+	FuncType *funcs;
+	Arg *args;
+	Monitor *m;
+	int failed = 0, n = 1, i;
+
+	for (cmd = cmds; *cmd; cmd++)
+		n += *cmd == ';';
+	funcs = ecalloc(n, sizeof(*funcs));
+	args = ecalloc(n, sizeof(*args));
+
+	*count = 0;
+	for (cmd = next_dispatch(cmds, &rest); cmd;
+		 cmd = next_dispatch(rest, &rest)) {
+		trim_whitespace(cmd);
+		if (cmd[0] == '\0')
+			continue;
+		if (!(funcs[*count] = parse_dispatch(cmd, &args[*count])))
+			failed++;
+		(*count)++;
+	}
+
+	arrange_batch++;
+	for (i = 0; i < *count && !failed; i++)
+		funcs[i](&args[i]);
+	for (i = 0; i < *count; i++) {
+		free(args[i].v);
+		free(args[i].v2);
+		free(args[i].v3);
+	}
+	free(funcs);
+	free(args);
+	if (--arrange_batch > 0)
+		return failed;
+
+	wl_list_for_each(m, &mons, link) {
+		if (!m->arrange_pending)
+			continue;
+		m->arrange_pending = false;
+		arrange(m, m->arrange_pending_animation);
+		m->arrange_pending_animation = false;
+	}
+	return failed;
+}
+
 void client_change_mon(Client *c, Monitor *m) {
 	setmon(c, m, c->tags, true);
 	reset_foreign_tolevel(c);
@@ -1446,48 +1718,110 @@ void show_scratchpad(Client *c) {
 	setborder_color(c);
 }
 
-pid_t getparentprocess(pid_t p) {
-	unsigned int v = 0;
-
-	FILE *f;
-	char buf[256];
-	snprintf(buf, sizeof(buf) - 1, "/proc/%u/stat", (unsigned)p);
+/* start 传入子进程的启动时间,返回时是 p 自己的启动时间。
+ * 刚从 /proc 读到的父进程比子进程启动得晚,说明 pid 已经被复用,返回 0。
+ * 缓存命中时没法这样判断:进程退出后 pid 给了一个更早启动的祖先进程,
+ * 旧记录照样能通过比较。所以缓存只靠 PROC_CACHE_TTL_MS 过期,
+ * 开着 proc connector 时退出事件会通过 proc_forget 立刻清掉记录,
+ * 否则最多会用上 TTL 这么久的旧 ppid */
+pid_t getparentprocess(pid_t p, unsigned long long *start) {
+	ProcEntry *e = &proc_cache[(unsigned int)p % LENGTH(proc_cache)];
+	unsigned long long starttime;
+	struct timespec now;
+	char buf[512], *s;
+	long now_ms;
+	ssize_t len;
+	int fd, ppid;
+	pid_t tree_ppid;
 
-	if (!(f = fopen(buf, "r")))
-		return 0;
+	// proc connector 记录过的进程不用读 /proc
+	if (proc_tree_parent(p, &tree_ppid))
+		return tree_ppid;
 
-	// 检查fscanf返回值，确保成功读取了1个参数
-	if (fscanf(f, "%*u %*s %*c %u", &v) != 1) {
-		fclose(f);
-		return 0;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	now_ms = now.tv_sec * 1000 + now.tv_nsec / 1000000;
+	// 启动时间的比较只排除比子进程还晚启动的记录,不能发现 pid 复用
+	if (e->pid == p && now_ms - e->checked < PROC_CACHE_TTL_MS &&
+		e->starttime <= *start) {
+		*start = e->starttime;
+		return e->ppid;
 	}
 
-	fclose(f);
-
-	return (pid_t)v;
-}
-
-int isdescprocess(pid_t p, pid_t c) {
-	while (p != c && c != 0)
-		c = getparentprocess(c);
+	snprintf(buf, sizeof(buf), "/proc/%u/stat", (unsigned)p);
+	if ((fd = open(buf, O_RDONLY | O_CLOEXEC)) < 0)
+		return 0;
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return 0;
+	buf[len] = '\0';
+
+	// 进程名里可能有空格和括号,从最后一个 ')' 之后开始解析
+	s = strrchr(buf, ')');
+	if (!s || sscanf(s + 1,
+					 " %*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u"
+					 " %*d %*d %*d %*d %*d %*d %llu",
+					 &ppid, &starttime) != 2)
+		return 0;
 
-	return (int)c;
+	e->pid = p;
+	e->ppid = ppid;
+	e->starttime = starttime;
+	e->checked = now_ms;
+	// 比子进程启动得还晚,说明原来的父进程已经退出,pid 被别的进程复用了
+	if (starttime > *start)
+		return 0;
+	*start = starttime;
+	return ppid;
 }
 
+/* 从新窗口的进程往上只走一遍,每一步在终端 pid 的哈希表里查找 */
 Client *termforwin(Client *w) {
-	Client *c;
+	unsigned long long start = ULLONG_MAX;
+	unsigned int n = 0, size = 8, i, depth;
+	Client *c, *found = NULL, **terms;
+	pid_t pid;
 
 	if (!w->pid || w->isterm || w->noswallow)
 		return NULL;
 
 	wl_list_for_each(c, &fstack, flink) {
-		if (c->isterm && !c->swallowing && c->pid &&
-			isdescprocess(c->pid, w->pid)) {
-			return c;
+		if (c->isterm && !c->swallowing && c->pid && !c->pid_exited)
+			n++;
+	}
+	if (!n)
+		return NULL;
+	while (size < n * 2)
+		size *= 2;
+	terms = ecalloc(size, sizeof(*terms));
+
+	// 同一个 pid 有多个终端窗口时保留 fstack 里靠前的那个
+	wl_list_for_each(c, &fstack, flink) {
+		if (!c->isterm || c->swallowing || !c->pid || c->pid_exited)
+			continue;
+		for (i = (unsigned int)c->pid & (size - 1); terms[i];
+			 i = (i + 1) & (size - 1)) {
+			if (terms[i]->pid == c->pid)
+				break;
 		}
+		if (!terms[i])
+			terms[i] = c;
 	}
 
-	return NULL;
+	for (pid = w->pid, depth = 0; pid > 0 && depth < 64 && !found;
+		 depth++) {
+		for (i = (unsigned int)pid & (size - 1); terms[i];
+			 i = (i + 1) & (size - 1)) {
+			if (terms[i]->pid == pid) {
+				found = terms[i];
+				break;
+			}
+		}
+		pid = getparentprocess(pid, &start);
+	}
+
+	free(terms);
+	return found;
 }
 
 void swallow(Client *c, Client *w) {
@@ -1504,6 +1838,7 @@ void swallow(Client *c, Client *w) {
 	c->scroller_proportion = w->scroller_proportion;
 	wl_list_insert(&w->link, &c->link);
 	wl_list_insert(&w->flink, &c->flink);
+	client_set_listed(c, 1);
 
 	if (w->foreign_toplevel)
 		remove_foreign_topleve(w);
@@ -1545,7 +1880,8 @@ void toggle_render_border(const Arg *arg) {
 	arrange(selmon, false);
 }
 
-Client *get_client_by_id_or_title(const char *arg_id, const char *arg_title) {
+Client *get_client_by_id_or_title(const char *arg_id, const char *arg_title,
+								  int slot) {
 	Client *target_client = NULL;
 	const char *appid, *title;
 	Client *c = NULL;
@@ -1554,6 +1890,15 @@ Client *get_client_by_id_or_title(const char *arg_id, const char *arg_title) {
 			continue;
 		}
 
+		// 配置里的绑定直接用窗口缓存的匹配结果
+		if (slot >= 0) {
+			if (client_rule_hit(c, slot)) {
+				target_client = c;
+				break;
+			}
+			continue;
+		}
+
 		if (!(appid = client_get_appid(c)))
 			appid = broken;
 		if (!(title = client_get_title(c)))
@@ -1600,7 +1945,8 @@ void toggle_named_scratchpad(const Arg *arg) {
 	char *arg_id = arg->v;
 	char *arg_title = arg->v2;
 
-	target_client = get_client_by_id_or_title(arg_id, arg_title);
+	target_client = get_client_by_id_or_title(arg_id, arg_title,
+											  named_scratchpad_slot(arg));
 
 	if (!target_client && arg->v3) {
 		Arg arg_spawn = {.v = arg->v3};
@@ -1752,39 +2098,67 @@ setclient_coordinate_center(Client *c, struct wlr_box geom, int offsetx,
 }
 /* function implementations */
 
-int // 0.5 custom
-applyrulesgeom(Client *c) {
-	/* rule matching */
+uint32_t client_rule_hash(Client *c) {
 	const char *appid, *title;
-	ConfigWinRule *r;
-	int hit = 0;
-	int ji;
 
 	if (!(appid = client_get_appid(c)))
 		appid = broken;
 	if (!(title = client_get_title(c)))
 		title = broken;
+	return rule_string_hash(appid, strlen(appid)) * 0x9e3779b1u ^
+		   rule_string_hash(title, strlen(title));
+}
+
+const unsigned long *client_rule_matches(Client *c) {
+	const char *appid, *title;
+	unsigned int words;
+
+	if (c->rule_match_generation == config_generation)
+		return c->rule_matches;
+
+	// 只在标题/appid 变化或者配置重载后重新跑规则匹配
+	if (!(appid = client_get_appid(c)))
+		appid = broken;
+	if (!(title = client_get_title(c)))
+		title = broken;
+
+	words = window_rules_words();
+	free(c->rule_matches);
+	c->rule_matches = words ? ecalloc(words, sizeof(unsigned long)) : NULL;
+	if (c->rule_matches)
+		window_rules_match(appid, title, c->rule_matches);
+	c->rule_match_hash = client_rule_hash(c);
+	c->rule_match_generation = config_generation;
+	return c->rule_matches;
+}
+
+bool client_rule_hit(Client *c, int ji) {
+	const unsigned long *matches = client_rule_matches(c);
+	return matches && WINRULE_HIT(matches, ji);
+}
+
+int // 0.5 custom
+applyrulesgeom(Client *c) {
+	/* rule matching */
+	ConfigWinRule *r;
+	int hit = 0;
+	int ji;
 
 	for (ji = 0; ji < config.window_rules_count; ji++) {
-		if (config.window_rules_count < 1)
-			break;
+		if (!client_rule_hit(c, ji))
+			continue;
 		r = &config.window_rules[ji];
-		if ((regex_match(r->title, title) && !r->id) ||
-			(r->id && regex_match(r->id, appid) && !r->title) ||
-			(r->id && regex_match(r->id, appid) && r->title &&
-			 regex_match(r->title, title))) {
-			c->geom.width = r->width > 0 ? r->width : c->geom.width;
-			c->geom.height = r->height > 0 ? r->height : c->geom.height;
-			// 重新计算居中的坐标
-			if (r->offsetx != 0 || r->offsety != 0 || r->width > 0 ||
-				r->height > 0)
-				c->geom = setclient_coordinate_center(c, c->geom, r->offsetx,
-													  r->offsety);
-			hit = r->height > 0 || r->width > 0 || r->offsetx != 0 ||
-						  r->offsety != 0
-					  ? 1
-					  : 0;
-		}
+		c->geom.width = r->width > 0 ? r->width : c->geom.width;
+		c->geom.height = r->height > 0 ? r->height : c->geom.height;
+		// 重新计算居中的坐标
+		if (r->offsetx != 0 || r->offsety != 0 || r->width > 0 ||
+			r->height > 0)
+			c->geom = setclient_coordinate_center(c, c->geom, r->offsetx,
+												  r->offsety);
+		hit = r->height > 0 || r->width > 0 || r->offsetx != 0 ||
+					  r->offsety != 0
+				  ? 1
+				  : 0;
 	}
 	return hit;
 }
@@ -1792,7 +2166,6 @@ applyrulesgeom(Client *c) {
 void // 17
 applyrules(Client *c) {
 	/* rule matching */
-	const char *appid, *title;
 	unsigned int i, newtags = 0;
 	int ji;
 	const ConfigWinRule *r;
@@ -1800,76 +2173,65 @@ applyrules(Client *c) {
 	bool hit_rule_pos = false;
 
 	c->isfloating = client_is_float_type(c);
-	if (!(appid = client_get_appid(c)))
-		appid = broken;
-	if (!(title = client_get_title(c)))
-		title = broken;
 
 	c->pid = client_get_pid(c);
 
 	for (ji = 0; ji < config.window_rules_count; ji++) {
-		if (config.window_rules_count < 1)
-			break;
+		if (!client_rule_hit(c, ji))
+			continue;
 		r = &config.window_rules[ji];
 
-		if ((r->title && regex_match(r->title, title) && !r->id) ||
-			(r->id && regex_match(r->id, appid) && !r->title) ||
-			(r->id && regex_match(r->id, appid) && r->title &&
-			 regex_match(r->title, title))) {
-			c->isterm = r->isterm >= 0 ? r->isterm : c->isterm;
-			c->noswallow = r->noswallow >= 0 ? r->noswallow : c->noswallow;
-			c->nofadein = r->nofadein >= 0 ? r->nofadein : c->nofadein;
-			c->nofadeout = r->nofadeout >= 0 ? r->nofadeout : c->nofadeout;
-			c->no_force_center = r->no_force_center >= 0 ? r->no_force_center
-														 : c->no_force_center;
-			c->scratchpad_geom.width = r->scratchpad_width > 0
-										   ? r->scratchpad_width
-										   : c->scratchpad_geom.width;
-			c->scratchpad_geom.height = r->scratchpad_height > 0
-											? r->scratchpad_height
-											: c->scratchpad_geom.height;
-			c->isfloating = r->isfloating >= 0 ? r->isfloating : c->isfloating;
-			c->isfullscreen =
-				r->isfullscreen >= 0 ? r->isfullscreen : c->isfullscreen;
-			c->animation_type_open = r->animation_type_open == NULL
-										 ? c->animation_type_open
-										 : r->animation_type_open;
-			c->animation_type_close = r->animation_type_close == NULL
-										  ? c->animation_type_close
-										  : r->animation_type_close;
-			c->scroller_proportion = r->scroller_proportion > 0
-										 ? r->scroller_proportion
-										 : c->scroller_proportion;
-			c->isnoborder = r->isnoborder >= 0 ? r->isnoborder : c->isnoborder;
-			c->isopensilent =
-				r->isopensilent >= 0 ? r->isopensilent : c->isopensilent;
-			c->isopenscratchpad = r->isopenscratchpad >= 0
-									  ? r->isopenscratchpad
-									  : c->isopenscratchpad;
-			c->isglobal = r->isglobal >= 0 ? r->isglobal : c->isglobal;
-			c->isoverlay = r->isoverlay >= 0 ? r->isoverlay : c->isoverlay;
-			c->isunglobal = r->isunglobal >= 0 ? r->isunglobal : c->isunglobal;
-
-			newtags = r->tags > 0 ? r->tags | newtags : newtags;
-			i = 0;
-			wl_list_for_each(m, &mons, link) if (r->monitor == i++) mon = m;
-
-			if (c->isopenscratchpad)
-				c->isfloating = 1;
-
-			if (c->isopenscratchpad == 2)
-				c->isnamedscratchpand = 1;
-
-			if (c->isfloating) {
-				c->geom.width = r->width > 0 ? r->width : c->geom.width;
-				c->geom.height = r->height > 0 ? r->height : c->geom.height;
-				// 重新计算居中的坐标
-				if (r->offsetx != 0 || r->offsety != 0 || r->width > 0 ||
-					r->height > 0) {
-					hit_rule_pos = true;
-					c->oldgeom = c->geom = setclient_coordinate_center(
-						c, c->geom, r->offsetx, r->offsety);
-				}
+		c->isterm = r->isterm >= 0 ? r->isterm : c->isterm;
+		c->noswallow = r->noswallow >= 0 ? r->noswallow : c->noswallow;
+		c->nofadein = r->nofadein >= 0 ? r->nofadein : c->nofadein;
+		c->nofadeout = r->nofadeout >= 0 ? r->nofadeout : c->nofadeout;
+		c->no_force_center = r->no_force_center >= 0 ? r->no_force_center
+													 : c->no_force_center;
+		c->scratchpad_geom.width = r->scratchpad_width > 0
+									   ? r->scratchpad_width
+									   : c->scratchpad_geom.width;
+		c->scratchpad_geom.height = r->scratchpad_height > 0
+										? r->scratchpad_height
+										: c->scratchpad_geom.height;
+		c->isfloating = r->isfloating >= 0 ? r->isfloating : c->isfloating;
+		c->isfullscreen = r->isfullscreen >= 0 ? r->isfullscreen : c->isfullscreen;
+		c->animation_type_open = r->animation_type_open == NULL
+									 ? c->animation_type_open
+									 : r->animation_type_open;
+		c->animation_type_close = r->animation_type_close == NULL
+									  ? c->animation_type_close
+									  : r->animation_type_close;
+		c->scroller_proportion = r->scroller_proportion > 0
+									 ? r->scroller_proportion
+									 : c->scroller_proportion;
+		c->isnoborder = r->isnoborder >= 0 ? r->isnoborder : c->isnoborder;
+		c->isopensilent = r->isopensilent >= 0 ? r->isopensilent : c->isopensilent;
+		c->isopenscratchpad = r->isopenscratchpad >= 0
+								  ? r->isopenscratchpad
+								  : c->isopenscratchpad;
+		c->isglobal = r->isglobal >= 0 ? r->isglobal : c->isglobal;
+		c->isoverlay = r->isoverlay >= 0 ? r->isoverlay : c->isoverlay;
+		c->isunglobal = r->isunglobal >= 0 ? r->isunglobal : c->isunglobal;
+
+		newtags = r->tags > 0 ? r->tags | newtags : newtags;
+		i = 0;
+		wl_list_for_each(m, &mons, link) if (r->monitor == i++) mon = m;
+
+		if (c->isopenscratchpad)
+			c->isfloating = 1;
+
+		if (c->isopenscratchpad == 2)
+			c->isnamedscratchpand = 1;
+
+		if (c->isfloating) {
+			c->geom.width = r->width > 0 ? r->width : c->geom.width;
+			c->geom.height = r->height > 0 ? r->height : c->geom.height;
+			// 重新计算居中的坐标
+			if (r->offsetx != 0 || r->offsety != 0 || r->width > 0 ||
+				r->height > 0) {
+				hit_rule_pos = true;
+				c->oldgeom = c->geom = setclient_coordinate_center(
+					c, c->geom, r->offsetx, r->offsety);
 			}
 		}
 	}
@@ -1894,6 +2256,7 @@ applyrules(Client *c) {
 			swallow(c, p);
 			wl_list_remove(&p->link);
 			wl_list_remove(&p->flink);
+			client_set_listed(p, 0);
 			mon = p->mon;
 			newtags = p->tags;
 		}
@@ -1931,9 +2294,17 @@ applyrules(Client *c) {
 	setborder_color(c);
 }
 
+bool client_is_steady(Client *c) {
+	// 已经停在目标位置的窗口,单个窗口开关时无需重新配置
+	return !c->is_open_animation && !c->animation.tagining &&
+		   !c->animation.tagouting && wlr_box_equal(&c->geom, &c->current);
+}
+
 void // 17
 arrange(Monitor *m, bool want_animation) {
 	Client *c;
+	bool skip_steady_backup = arrange_skip_steady;
+	const char *ltname;
 
 	if (!m)
 		return;
@@ -1941,6 +2312,20 @@ arrange(Monitor *m, bool want_animation) {
 	if (!m->wlr_output->enabled)
 		return;
 
+	if (arrange_batch) {
+		m->arrange_pending = true;
+		m->arrange_pending_animation |= want_animation;
+		return;
+	}
+
+	/* A single map/unmap under tile or scroller only changes the boxes of
+	 * one column (or the strip neighbours), so leave the rest alone. */
+	ltname = m->pertag->ltidxs[m->pertag->curtag]->name;
+	arrange_skip_steady =
+		arrange_incremental && !want_animation && !m->isoverview &&
+		!no_border_when_single &&
+		(strcmp(ltname, "tile") == 0 || strcmp(ltname, "scroller") == 0);
+
 	m->visible_clients = 0;
 	wl_list_for_each(c, &clients, link) {
 		if (c->iskilling)
@@ -1948,6 +2333,7 @@ arrange(Monitor *m, bool want_animation) {
 
 		if (c->mon == m && (c->isglobal || c->isunglobal)) {
 			c->tags = m->tagset[m->seltags];
+			client_update_tagcount(c);
 			if (selmon->sel == NULL)
 				focusclient(c, 0);
 		}
@@ -2008,7 +2394,8 @@ arrange(Monitor *m, bool want_animation) {
 				c->animation.from_rule = false;
 				c->animation.tagouting = false;
 				c->animation.tagouted = false;
-				resize(c, c->geom, 0);
+				if (!arrange_skip_steady || !client_is_steady(c))
+					resize(c, c->geom, 0);
 
 			} else {
 				if ((c->tags & (1 << (m->pertag->prevtag - 1))) &&
@@ -2060,6 +2447,8 @@ arrange(Monitor *m, bool want_animation) {
 		m->pertag->ltidxs[m->pertag->curtag]->arrange(m);
 	}
 
+	arrange_skip_steady = skip_steady_backup;
+
 	motionnotify(0, NULL, 0, 0, 0, 0);
 	checkidleinhibitor(NULL);
 }
@@ -2736,7 +3125,7 @@ buttonpress(struct wl_listener *listener, void *data) {
 				selmon->sel = NULL;
 			}
 			selmon = xytomon(cursor->x, cursor->y);
-			client_update_oldmonname_record(grabc, selmon);
+			client_update_oldmon_record(grabc, selmon);
 			setmon(grabc, selmon, 0, true);
 			reset_foreign_tolevel(grabc);
 			selmon->prevsel = selmon->sel;
@@ -2834,7 +3223,18 @@ void cleanuplisteners(void) {
 }
 
 void cleanup(void) {
+	size_t i;
+
 	cleanuplisteners();
+	config_watch_finish();
+	proc_events_finish();
+	ipc_socket_finish();
+	startup_queue_finish();
+	launcher_finish();
+	if (printstatus_idle) {
+		wl_event_source_remove(printstatus_idle);
+		printstatus_idle = NULL;
+	}
 #ifdef XWAYLAND
 	wlr_xwayland_destroy(xwayland);
 	xwayland = NULL;
@@ -2859,6 +3259,12 @@ void cleanup(void) {
 	/* Destroy after the wayland display (when the monitors are already
 	   destroyed) to avoid destroying them with an invalid scene output. */
 	wlr_scene_node_destroy(&scene->tree.node);
+	free_config();
+	for (i = 0; i < LENGTH(pools); i++)
+		pool_finish(pools[i]);
+	for (i = 0; i < output_names_count; i++)
+		free(output_names[i]);
+	free(output_names);
 }
 
 void // 17
@@ -2921,11 +3327,12 @@ void closemon(Monitor *m) {
 			if (selmon == NULL) {
 				remove_foreign_topleve(c);
 				c->mon = NULL;
+				client_update_tagcount(c);
 			} else {
 				client_change_mon(c, selmon);
 			}
 
-			client_update_oldmonname_record(c, m);
+			client_update_oldmon_record(c, m);
 		}
 	}
 	if (selmon) {
@@ -3153,7 +3560,7 @@ void createkeyboard(struct wlr_keyboard *keyboard) {
 }
 
 KeyboardGroup *createkeyboardgroup(void) {
-	KeyboardGroup *group = ecalloc(1, sizeof(*group));
+	KeyboardGroup *group = pool_alloc(&keyboard_group_pool);
 	struct xkb_context *context;
 	struct xkb_keymap *keymap;
 
@@ -3222,7 +3629,7 @@ void createlayersurface(struct wl_listener *listener, void *data) {
 		return;
 	}
 
-	l = layer_surface->data = ecalloc(1, sizeof(*l));
+	l = layer_surface->data = pool_alloc(&layer_pool);
 	l->type = LayerShell;
 	LISTEN(&surface->events.commit, &l->surface_commit,
 		   commitlayersurfacenotify);
@@ -3279,6 +3686,7 @@ void createmon(struct wl_listener *listener, void *data) {
 
 	m = wlr_output->data = ecalloc(1, sizeof(*m));
 	m->wlr_output = wlr_output;
+	m->name_id = output_name_intern(wlr_output->name);
 
 	wl_list_init(&m->dwl_ipc_outputs);
 
@@ -3404,7 +3812,7 @@ createnotify(struct wl_listener *listener, void *data) {
 	Client *c = NULL;
 
 	/* Allocate a Client for this surface */
-	c = toplevel->base->data = ecalloc(1, sizeof(*c));
+	c = toplevel->base->data = pool_alloc(&client_pool);
 	c->surface.xdg = toplevel->base;
 	c->bw = borderpx;
 
@@ -3417,6 +3825,7 @@ createnotify(struct wl_listener *listener, void *data) {
 	LISTEN(&toplevel->events.request_maximize, &c->maximize, maximizenotify);
 	LISTEN(&toplevel->events.request_minimize, &c->minimize, minimizenotify);
 	LISTEN(&toplevel->events.set_title, &c->set_title, updatetitle);
+	LISTEN(&toplevel->events.set_app_id, &c->set_appid, updateappid);
 }
 
 void createpointer(struct wlr_pointer *pointer) {
@@ -3543,7 +3952,7 @@ void destroylayersurfacenotify(struct wl_listener *listener, void *data) {
 	wl_list_remove(&l->surface_commit.link);
 	wlr_scene_node_destroy(&l->scene->node);
 	wlr_scene_node_destroy(&l->popups->node);
-	free(l);
+	pool_free(&layer_pool, l);
 }
 
 void destroylock(SessionLock *lock, int unlock) {
@@ -3593,6 +4002,7 @@ destroynotify(struct wl_listener *listener, void *data) {
 	Client *c = wl_container_of(listener, c, destroy);
 	wl_list_remove(&c->destroy.link);
 	wl_list_remove(&c->set_title.link);
+	wl_list_remove(&c->set_appid.link);
 	wl_list_remove(&c->fullscreen.link);
 	wl_list_remove(&c->maximize.link);
 	wl_list_remove(&c->minimize.link);
@@ -3610,7 +4020,8 @@ destroynotify(struct wl_listener *listener, void *data) {
 		wl_list_remove(&c->map.link);
 		wl_list_remove(&c->unmap.link);
 	}
-	free(c);
+	free(c->rule_matches);
+	pool_free(&client_pool, c);
 }
 
 void destroypointerconstraint(struct wl_listener *listener, void *data) {
@@ -3638,7 +4049,7 @@ void destroykeyboardgroup(struct wl_listener *listener, void *data) {
 	wl_list_remove(&group->modifiers.link);
 	wl_list_remove(&group->destroy.link);
 	wlr_keyboard_group_destroy(group->wlr_group);
-	free(group);
+	pool_free(&keyboard_group_pool, group);
 }
 
 Monitor *dirtomon(enum wlr_direction dir) {
@@ -3716,6 +4127,7 @@ void focusclient(Client *c, int lift) {
 
 		// change border color
 		c->isurgent = 0;
+		client_update_tagcount(c);
 		setborder_color(c);
 	}
 
@@ -3955,21 +4367,34 @@ keybinding(unsigned int mods, xkb_keysym_t sym, unsigned int keycode) {
 	 */
 	int handled = 0;
 	const KeyBinding *k;
+	unsigned int generation = config_generation;
+	uint32_t cmods = CLEANMASK(mods);
+	xkb_keysym_t nsym = normalize_keysym(sym);
+	int si = key_binding_index_first(&config.keysym_index, cmods, nsym);
+	int ci = key_binding_index_first(&config.keycode_index, cmods, keycode);
 	int ji;
-	for (ji = 0; ji < config.key_bindings_count; ji++) {
-		if (config.key_bindings_count < 1)
-			break;
-		k = &config.key_bindings[ji];
-		if (CLEANMASK(mods) == CLEANMASK(k->mod) &&
-			((k->keysymcode.type == KEY_TYPE_SYM &&
-			  normalize_keysym(sym) ==
-				  normalize_keysym(k->keysymcode.keysym)) ||
-			 (k->keysymcode.type == KEY_TYPE_CODE &&
-			  keycode == k->keysymcode.keycode)) &&
-			k->func) {
-			k->func(&k->arg);
-			handled = 1;
+
+	/* keysym 和 keycode 两条链都按下标升序,合并遍历以保持配置顺序 */
+	while (si >= 0 || ci >= 0) {
+		if (ci < 0 || (si >= 0 && si < ci)) {
+			ji = si;
+			si = config.keysym_index.next[si];
+		} else {
+			ji = ci;
+			ci = config.keycode_index.next[ci];
 		}
+		k = &config.key_bindings[ji];
+		if (CLEANMASK(k->mod) != cmods || !k->func)
+			continue;
+		if (k->keysymcode.type == KEY_TYPE_CODE
+				? k->keysymcode.keycode != keycode
+				: normalize_keysym(k->keysymcode.keysym) != nsym)
+			continue;
+		k->func(&k->arg);
+		handled = 1;
+		/* the binding reloaded the config, the index is gone */
+		if (generation != config_generation)
+			break;
 	}
 	return handled;
 }
@@ -3981,21 +4406,23 @@ bool keypressglobal(struct wlr_surface *last_surface,
 	Client *c = NULL, *lastc = focustop(selmon);
 	unsigned int keycodes[32] = {0};
 	int reset = false;
-	const char *appid = NULL;
-	const char *title = NULL;
+	int si = key_binding_index_first(&config.globalkey_keysym_index, mods,
+									 keysym);
+	int ci = key_binding_index_first(&config.globalkey_keycode_index, mods,
+									 keycode);
 	int ji;
 	const ConfigWinRule *r;
 
-	for (ji = 0; ji < config.window_rules_count; ji++) {
-		if (config.window_rules_count < 1)
-			break;
+	while (si >= 0 || ci >= 0) {
+		if (ci < 0 || (si >= 0 && si < ci)) {
+			ji = si;
+			si = config.globalkey_keysym_index.next[si];
+		} else {
+			ji = ci;
+			ci = config.globalkey_keycode_index.next[ci];
+		}
 		r = &config.window_rules[ji];
 
-		if (!r->globalkeybinding.mod ||
-			(!r->globalkeybinding.keysymcode.keysym &&
-			 !r->globalkeybinding.keysymcode.keycode))
-			continue;
-
 		/* match key only (case insensitive) ignoring mods */
 		if (((r->globalkeybinding.keysymcode.type == KEY_TYPE_SYM &&
 			  r->globalkeybinding.keysymcode.keysym == keysym) ||
@@ -4003,23 +4430,13 @@ bool keypressglobal(struct wlr_surface *last_surface,
 			  r->globalkeybinding.keysymcode.keycode == keycode)) &&
 			r->globalkeybinding.mod == mods) {
 			wl_list_for_each(c, &clients, link) {
-				if (c && c != lastc) {
-					appid = client_get_appid(c);
-					title = client_get_title(c);
-
-					if ((r->title && regex_match(r->title, title) && !r->id) ||
-						(r->id && regex_match(r->id, appid) && !r->title) ||
-						(r->id && regex_match(r->id, appid) && r->title &&
-						 regex_match(r->title, title))) {
-						reset = true;
-						wlr_seat_keyboard_enter(seat, client_surface(c),
-												keycodes, 0,
-												&keyboard->modifiers);
-						wlr_seat_keyboard_send_key(seat, event->time_msec,
-												   event->keycode,
-												   event->state);
-						goto done;
-					}
+				if (c && c != lastc && client_rule_hit(c, ji)) {
+					reset = true;
+					wlr_seat_keyboard_enter(seat, client_surface(c), keycodes,
+											0, &keyboard->modifiers);
+					wlr_seat_keyboard_send_key(seat, event->time_msec,
+											   event->keycode, event->state);
+					goto done;
 				}
 			}
 		}
@@ -4388,21 +4805,26 @@ mapnotify(struct wl_listener *listener, void *data) {
 	} else
 		wl_list_insert(clients.prev, &c->link); // 尾部入栈
 	wl_list_insert(&fstack, &c->flink);
+	client_set_listed(c, 1);
 
 	/* Set initial monitor, tags, floating status, and focus:
 	 * we always consider floating, clients that have parent and thus
 	 * we set the same tags and monitor than its parent, if not
 	 * try to apply rules for them */
+	arrange_incremental = true;
 	if ((p = client_get_parent(c))) {
 		c->isfloating = 1;
 		setmon(c, p->mon, p->tags, true);
 	} else {
 		applyrules(c);
 	}
+	arrange_incremental = false;
 
 	// make sure the animation is open type
 	c->is_open_animation = true;
 	resize(c, c->geom, 0);
+	client_watch_pid(c);
+	ipc_event_client(IPC_EVENT_WINDOW, c, "open");
 	printstatus();
 }
 
@@ -4441,6 +4863,7 @@ void set_minized(Client *c) {
 	c->oldtags = c->mon->tagset[c->mon->seltags];
 	c->mini_restore_tag = c->tags;
 	c->tags = 0;
+	client_update_tagcount(c);
 	c->isminied = 1;
 	c->is_in_scratchpad = 1;
 	c->is_scratchpad_show = 0;
@@ -4754,6 +5177,7 @@ void pointerfocus(Client *c, struct wlr_surface *surface, double sx, double sy,
 	wlr_seat_pointer_notify_motion(seat, time, sx, sy);
 }
 
+// 只标记需要更新,同一轮事件循环里的多次调用合并成一帧发给状态栏
 void // 17
 printstatus(void) {
 	Monitor *m = NULL;
@@ -4761,8 +5185,27 @@ printstatus(void) {
 		if (!m->wlr_output->enabled) {
 			continue;
 		}
-		dwl_ipc_output_printstatus(m); // 更新waybar上tag的状态 这里很关键
+		m->status_dirty = 1;
 	}
+	if (!printstatus_idle && event_loop)
+		printstatus_idle =
+			wl_event_loop_add_idle(event_loop, printstatus_flush, NULL);
+}
+
+void printstatus_flush(void *data) {
+	Monitor *m = NULL;
+
+	printstatus_idle = NULL;
+	wl_list_for_each(m, &mons, link) {
+		if (!m->status_dirty)
+			continue;
+		m->status_dirty = 0;
+		if (m->wlr_output->enabled) {
+			dwl_ipc_output_printstatus(m); // 更新waybar上tag的状态 这里很关键
+			ipc_socket_status(m);
+		}
+	}
+	ipc_socket_focus();
 }
 
 void powermgrsetmode(struct wl_listener *listener, void *data) {
@@ -4915,7 +5358,8 @@ void rendermon(struct wl_listener *listener, void *data) {
 		need_more_frames = client_draw_fadeout_frame(c) || need_more_frames;
 	}
 
-	wlr_scene_output_commit(m->scene_output, NULL);
+	if (wlr_scene_output_commit(m->scene_output, NULL))
+		startup_frame_done();
 
 	// Send frame done notification
 	clock_gettime(CLOCK_MONOTONIC, &now);
@@ -5240,35 +5684,21 @@ run(char *startup_cmd) {
 	if (!socket)
 		die("startup: display_add_socket_auto");
 	setenv("WAYLAND_DISPLAY", socket, 1);
+	ipc_socket_init(socket);
 
 	/* Start the backend. This will enumerate outputs and inputs, become the DRM
 	 * master, etc */
 	if (!wlr_backend_start(backend))
 		die("startup: backend_start");
 
-	/* Now that the socket exists and the backend is started, run the startup
-	 * command */
+	/* Now that the socket exists and the backend is started, queue the
+	 * startup command. It runs once the first frame is on screen */
+	startup_queue_init();
 	if (!startup_cmd)
 		startup_cmd = get_autostart_path(autostart_temp_path,
 										 sizeof(autostart_temp_path));
-	if (startup_cmd) {
-		int piperw[2];
-		if (pipe(piperw) < 0)
-			die("startup: pipe:");
-		if ((child_pid = fork()) < 0)
-			die("startup: fork:");
-		if (child_pid == 0) {
-			setsid();
-			dup2(piperw[0], STDIN_FILENO);
-			close(piperw[0]);
-			close(piperw[1]);
-			execl("/bin/sh", "/bin/sh", "-c", startup_cmd, NULL);
-			die("startup: execl:");
-		}
-		dup2(piperw[1], STDOUT_FILENO);
-		close(piperw[1]);
-		close(piperw[0]);
-	}
+	if (startup_cmd)
+		startup_queue_push(startup_cmd, true);
 
 	/* Mark stdout as non-blocking to avoid people who does not close stdin
 	 * nor consumes it in their startup script getting dwl frozen */
@@ -5868,6 +6298,9 @@ void setmon(Client *c, Monitor *m, unsigned int newtags, bool focus) {
 		c->tags =
 			newtags ? newtags
 					: m->tagset[m->seltags]; /* assign tags of target monitor */
+	}
+	client_update_tagcount(c);
+	if (m) {
 		setfloating(c, c->isfloating);
 		setfullscreen(c, c->isfullscreen); /* This will call arrange(c->mon) */
 	}
@@ -6000,11 +6433,15 @@ void destroy_all_virtual_output(const Arg *arg) {
 
 void setup(void) {
 
+	// 趁合成器还没有分配大块内存时启动辅助进程,之后的 spawn 都交给它
+	launcher_start();
+
 	setenv("XCURSOR_SIZE", "24", 1);
 	setenv("XDG_CURRENT_DESKTOP", "maomao", 1);
 
 	parse_config();
 	init_baked_points();
+	config_cache_save();
 
 	int drm_fd, i, sig[] = {SIGCHLD, SIGINT, SIGTERM, SIGPIPE};
 	struct sigaction sa = {.sa_flags = SA_RESTART, .sa_handler = handlesig};
@@ -6019,6 +6456,8 @@ void setup(void) {
 	 * clients from the Unix socket, manging Wayland globals, and so on. */
 	dpy = wl_display_create();
 	event_loop = wl_display_get_event_loop(dpy);
+	config_watch_update();
+	proc_events_update();
 	pointer_manager = wlr_relative_pointer_manager_v1_create(dpy);
 	/* The backend is a wlroots feature which abstracts the underlying input and
 	 * output hardware. The autocreate option will choose the most suitable
@@ -6246,7 +6685,7 @@ void setup(void) {
 	dwl_input_method_relay = calloc(1, sizeof(*dwl_input_method_relay));
 	dwl_input_method_relay = dwl_im_relay_create();
 
-	wl_global_create(dpy, &zdwl_ipc_manager_v2_interface, 2, NULL,
+	wl_global_create(dpy, &zdwl_ipc_manager_v2_interface, 3, NULL,
 					 dwl_ipc_manager_bind);
 
 	// 创建顶层管理句柄
@@ -6273,43 +6712,95 @@ void setup(void) {
 #endif
 }
 
+/* 把 spawn 的命令按空格切好,参数之间用 SPAWN_SEP 分隔。
+ * 不含特殊字符的参数原样使用,含 $ ~ 引号等的参数标上 SPAWN_EXPAND,
+ * 执行时再 wordexp,这样环境变量取的是执行时的值。
+ * 有命令替换的命令返回 NULL,交给 /bin/sh -c 执行 */
+char *spawn_tokenize(const char *cmd) {
+	const char *p = cmd, *end;
+	char *out, *o;
+	int argc = 0;
+
+	if (!cmd || strchr(cmd, '`') || strstr(cmd, "$("))
+		return NULL;
+
+	o = out = malloc(strlen(cmd) * 2 + 1);
+	if (!out)
+		return NULL;
+	while (*p && argc < SPAWN_MAX_ARGS) {
+		while (*p == ' ')
+			p++;
+		if (!*p)
+			break;
+		end = p + strcspn(p, " ");
+		if (argc++)
+			*o++ = SPAWN_SEP[0];
+		if (strcspn(p, "$~*?[{\\\"'") < (size_t)(end - p))
+			*o++ = SPAWN_EXPAND;
+		memcpy(o, p, end - p);
+		o += end - p;
+		p = end;
+	}
+	*o = '\0';
+	return out;
+}
+
 void spawn(const Arg *arg) {
+	extern char **environ;
+	char *argv[SPAWN_MAX_ARGS + 1], *tokens, *token, *save = NULL;
+	char *shell_argv[] = {"/bin/sh", "-c", arg->v, NULL};
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	wordexp_t words[SPAWN_MAX_ARGS];
+	int argc = 0, nwords = 0, err, i;
+	pid_t pid;
 
 	if (!arg->v)
 		return;
 
-	if (fork() == 0) {
-		// 1. 忽略可能导致 coredump 的信号
-		signal(SIGSEGV, SIG_IGN);
-		signal(SIGABRT, SIG_IGN);
-		signal(SIGILL, SIG_IGN);
-
-		dup2(STDERR_FILENO, STDOUT_FILENO);
-		setsid();
-
-		// 2. 解析参数
-		char *argv[64];
-		int argc = 0;
-		char *token = strtok((char *)arg->v, " ");
-		while (token != NULL && argc < 63) {
-			wordexp_t p;
-			if (wordexp(token, &p, 0) == 0) {
-				argv[argc++] = p.we_wordv[0];
-			} else {
-				argv[argc++] = token;
+	// 绑定的命令在读配置时已经切好,其他地方来的命令现在切
+	tokens = arg->v2 ? strdup(arg->v2) : spawn_tokenize(arg->v);
+	for (token = tokens ? strtok_r(tokens, SPAWN_SEP, &save) : NULL; token;
+		 token = strtok_r(NULL, SPAWN_SEP, &save)) {
+		argv[argc] = token;
+		if (token[0] == SPAWN_EXPAND) {
+			argv[argc] = ++token;
+			if (wordexp(token, &words[nwords], WRDE_NOCMD) == 0) {
+				if (words[nwords].we_wordc > 0)
+					argv[argc] = words[nwords].we_wordv[0];
+				nwords++;
 			}
-			token = strtok(NULL, " ");
 		}
-		argv[argc] = NULL;
+		argc++;
+	}
+	argv[argc] = NULL;
+	if (tokens && argc == 0) {
+		free(tokens);
+		return;
+	}
+	if (launcher_spawn(tokens ? argv : shell_argv))
+		goto out;
 
-		// 3. 执行命令
-		execvp(argv[0], argv);
+	/* posix_spawn 用 vfork 式的方式启动,不用复制合成器的页表。
+	 * 和以前一样新建会话,并把 stdout 指向 stderr */
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, STDERR_FILENO, STDOUT_FILENO);
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
 
-		// 4. execvp 失败时：打印错误并直接退出（避免 coredump）
-		wlr_log(WLR_ERROR, "dwl: execvp '%s' failed: %s\n", argv[0],
-				strerror(errno));
-		_exit(EXIT_FAILURE); // 使用 _exit 避免缓冲区刷新等操作
-	}
+	err = tokens ? posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ)
+				 : posix_spawn(&pid, shell_argv[0], &actions, &attr,
+							   shell_argv, environ);
+	if (err)
+		wlr_log(WLR_ERROR, "spawn '%s' failed: %s",
+				tokens ? argv[0] : arg->v, strerror(err));
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+out:
+	for (i = 0; i < nwords; i++)
+		wordfree(&words[i]);
+	free(tokens);
 }
 
 void spawn_on_empty(const Arg *arg) {
@@ -6344,6 +6835,7 @@ void tag_client(const Arg *arg, Client *target_client) {
 	Client *fc;
 	if (target_client && arg->ui & TAGMASK) {
 		target_client->tags = arg->ui & TAGMASK;
+		client_update_tagcount(target_client);
 		wl_list_for_each(fc, &clients, link) {
 			if (fc && fc != target_client && target_client->tags & fc->tags &&
 				ISFULLSCREEN(fc) && !target_client->isfloating) {
@@ -6369,6 +6861,7 @@ void tagsilent(const Arg *arg) {
 	Client *fc;
 	Client *target_client = selmon->sel;
 	target_client->tags = arg->ui & TAGMASK;
+	client_update_tagcount(target_client);
 	wl_list_for_each(fc, &clients, link) {
 		if (fc && fc != target_client && target_client->tags & fc->tags &&
 			ISFULLSCREEN(fc) && !target_client->isfloating) {
@@ -6379,12 +6872,29 @@ void tagsilent(const Arg *arg) {
 	arrange(target_client->mon, false);
 }
 
-void client_update_oldmonname_record(Client *c, Monitor *m) {
+/* 输出名字换成小编号,同一个名字拔掉再插上编号不变,
+ * 窗口只记编号,恢复时比较整数 */
+unsigned int output_name_intern(const char *name) {
+	char **names;
+	unsigned int i;
+
+	for (i = 0; i < output_names_count; i++) {
+		if (strcmp(output_names[i], name) == 0)
+			return i + 1;
+	}
+	names = realloc(output_names, (output_names_count + 1) * sizeof(*names));
+	if (!names)
+		die("realloc:");
+	output_names = names;
+	if (!(output_names[output_names_count] = strdup(name)))
+		die("strdup:");
+	return ++output_names_count;
+}
+
+void client_update_oldmon_record(Client *c, Monitor *m) {
 	if (!c || c->iskilling || !client_surface(c)->mapped || c->mon == m)
 		return;
-	memset(c->oldmonname, 0, sizeof(c->oldmonname));
-	strncpy(c->oldmonname, m->wlr_output->name, sizeof(c->oldmonname) - 1);
-	c->oldmonname[sizeof(c->oldmonname) - 1] = '\0';
+	c->oldmon_id = m->name_id;
 }
 
 void tagmon(const Arg *arg) {
@@ -6402,7 +6912,7 @@ void tagmon(const Arg *arg) {
 	m = dirtomon(arg->i);
 
 	setmon(c, m, newtags, true);
-	client_update_oldmonname_record(c, m);
+	client_update_oldmon_record(c, m);
 
 	reset_foreign_tolevel(c);
 	// 重新计算居中的坐标
@@ -6712,6 +7222,7 @@ void toggletag(const Arg *arg) {
 	newtags = sel->tags ^ (arg->ui & TAGMASK);
 	if (newtags) {
 		sel->tags = newtags;
+		client_update_tagcount(sel);
 		focusclient(focustop(selmon), 1);
 		arrange(selmon, false);
 	}
@@ -6763,7 +7274,7 @@ void init_fadeout_client(Client *c) {
 		return;
 	}
 
-	Client *fadeout_cient = ecalloc(1, sizeof(*fadeout_cient));
+	Client *fadeout_cient = pool_alloc(&fadeout_pool);
 
 	wlr_scene_node_set_enabled(&c->scene->node, true);
 	client_set_border_color(c, bordercolor);
@@ -6772,7 +7283,7 @@ void init_fadeout_client(Client *c) {
 	wlr_scene_node_set_enabled(&c->scene->node, false);
 
 	if (!fadeout_cient->scene) {
-		free(fadeout_cient);
+		pool_free(&fadeout_pool, fadeout_cient);
 		return;
 	}
 
@@ -6879,9 +7390,14 @@ void unmapnotify(struct wl_listener *listener, void *data) {
 		if (client_surface(c) == seat->keyboard_state.focused_surface)
 			focusclient(focustop(selmon), 1);
 	} else {
+		ipc_event_client(IPC_EVENT_WINDOW, c, "close");
+		client_unwatch_pid(c);
 		if (!c->swallowing)
 			wl_list_remove(&c->link);
+		client_set_listed(c, 0);
+		arrange_incremental = true;
 		setmon(c, NULL, 0, true);
+		arrange_incremental = false;
 		if (!c->swallowing)
 			wl_list_remove(&c->flink);
 	}
@@ -6920,8 +7436,9 @@ void updatemons(struct wl_listener *listener, void *data) {
 		wlr_output_configuration_v1_create();
 	Client *c;
 	struct wlr_output_configuration_head_v1 *config_head;
+	struct wlr_box oldgeom;
 	Monitor *m;
-	int mon_pos_offsetx, mon_pos_offsety, oldx, oldy;
+	int mon_pos_offsetx, mon_pos_offsety;
 
 	/* First remove from the layout the disabled monitors */
 	wl_list_for_each(m, &mons, link) {
@@ -6958,13 +7475,23 @@ void updatemons(struct wl_listener *listener, void *data) {
 		config_head =
 			wlr_output_configuration_head_v1_create(config, m->wlr_output);
 
-		oldx = m->m.x;
-		oldy = m->m.y;
+		oldgeom = m->m;
 		/* Get the effective monitor geometry to use for surfaces */
 		wlr_output_layout_get_box(output_layout, m->wlr_output, &m->m);
+		config_head->state.x = m->m.x;
+		config_head->state.y = m->m.y;
+
+		if (!selmon)
+			selmon = m;
+
+		/* 位置和大小都没变的输出不用动,拔掉一个输出时其他输出保持原样。
+		 * 新接上或重新启用的输出之前的 m->m 是 0,总会走下面 */
+		if (wlr_box_equal(&oldgeom, &m->m))
+			continue;
+
 		m->w = m->m;
-		mon_pos_offsetx = m->m.x - oldx;
-		mon_pos_offsety = m->m.y - oldy;
+		mon_pos_offsetx = m->m.x - oldgeom.x;
+		mon_pos_offsety = m->m.y - oldgeom.y;
 
 		wl_list_for_each(c, &clients, link) {
 			// floating window position auto adjust the change of monitor
@@ -6978,7 +7505,7 @@ void updatemons(struct wl_listener *listener, void *data) {
 
 			// restore window to old monitor
 			if (c->mon && c->mon != m && client_surface(c)->mapped &&
-				strcmp(c->oldmonname, m->wlr_output->name) == 0) {
+				c->oldmon_id == m->name_id) {
 				client_change_mon(c, m);
 			}
 		}
@@ -7010,12 +7537,6 @@ void updatemons(struct wl_listener *listener, void *data) {
 		/* Try to re-set the gamma LUT when updating monitors,
 		 * it's only really needed when enabling a disabled output, but meh. */
 		m->gamma_lut_changed = 1;
-
-		config_head->state.x = m->m.x;
-		config_head->state.y = m->m.y;
-
-		if (!selmon)
-			selmon = m;
 	}
 
 	if (selmon && selmon->wlr_output->enabled) {
@@ -7042,16 +7563,27 @@ void updatemons(struct wl_listener *listener, void *data) {
 	wlr_output_manager_v1_set_configuration(output_mgr, config);
 }
 
+void updateappid(struct wl_listener *listener, void *data) {
+	Client *c = wl_container_of(listener, c, set_appid);
+	if (client_rule_hash(c) != c->rule_match_hash)
+		c->rule_match_generation = 0;
+}
+
 void updatetitle(struct wl_listener *listener, void *data) {
 	Client *c = wl_container_of(listener, c, set_title);
 
 	if (!c || c->iskilling)
 		return;
 
+	// 标题真的变了才让规则缓存失效
+	if (client_rule_hash(c) != c->rule_match_hash)
+		c->rule_match_generation = 0;
+
 	const char *title;
 	title = client_get_title(c);
 	if (title && c->foreign_toplevel)
 		wlr_foreign_toplevel_handle_v1_set_title(c->foreign_toplevel, title);
+	ipc_event_client(IPC_EVENT_TITLE, c, NULL);
 	if (c == focustop(c->mon))
 		printstatus();
 }
@@ -7072,6 +7604,7 @@ urgent(struct wl_listener *listener, void *data) {
 		if (client_surface(c)->mapped)
 			client_set_border_color(c, urgentcolor);
 		c->isurgent = 1;
+		client_update_tagcount(c);
 		printstatus();
 	}
 }
@@ -7686,6 +8219,7 @@ void activatex11(struct wl_listener *listener, void *data) {
 	if (c->isminied) {
 		c->isminied = 0;
 		c->tags = c->mini_restore_tag;
+		client_update_tagcount(c);
 		c->is_scratchpad_show = 0;
 		c->is_in_scratchpad = 0;
 		c->isnamedscratchpand = 0;
@@ -7704,6 +8238,7 @@ void activatex11(struct wl_listener *listener, void *data) {
 		need_arrange = false;
 	} else if (c != focustop(selmon)) {
 		c->isurgent = 1;
+		client_update_tagcount(c);
 		if (client_surface(c)->mapped)
 			client_set_border_color(c, urgentcolor);
 	}
@@ -7747,7 +8282,7 @@ void createnotifyx11(struct wl_listener *listener, void *data) {
 	Client *c;
 
 	/* Allocate a Client for this surface */
-	c = xsurface->data = ecalloc(1, sizeof(*c));
+	c = xsurface->data = pool_alloc(&client_pool);
 	c->surface.xwayland = xsurface;
 	c->type = X11;
 	/* Listen to the various events it can emit */
@@ -7760,6 +8295,7 @@ void createnotifyx11(struct wl_listener *listener, void *data) {
 		   fullscreennotify);
 	LISTEN(&xsurface->events.set_hints, &c->set_hints, sethints);
 	LISTEN(&xsurface->events.set_title, &c->set_title, updatetitle);
+	LISTEN(&xsurface->events.set_class, &c->set_appid, updateappid);
 	LISTEN(&xsurface->events.request_maximize, &c->maximize, maximizenotify);
 	LISTEN(&xsurface->events.request_minimize, &c->minimize, minimizenotify);
 }
@@ -7784,6 +8320,7 @@ void sethints(struct wl_listener *listener, void *data) {
 		return;
 
 	c->isurgent = xcb_icccm_wm_hints_get_urgency(c->surface.xwayland->hints);
+	client_update_tagcount(c);
 	printstatus();
 
 	if (c->isurgent && surface && surface->mapped)